@@ -0,0 +1,50 @@
+/**
+ * @file arena.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of structures and functions for arenas, bump
+ *        allocators whose memory is released all at once
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "types.h"
+#include "array_lists.h"
+
+#define ARENA_MIN_BLOCK_SIZE 65536 //Bytes of the first block
+#define ARENA_MAX_BLOCK_SIZE 16777216 //Largest size reached by doubling blocks
+
+typedef struct ArenaBlock {
+     struct ArenaBlock *next;
+     size_t size;
+     size_t used;
+} ArenaBlock;
+
+typedef struct Arena {
+     ArenaBlock *first;
+     ArenaBlock *current;
+     size_t block_size;
+} Arena;
+
+/************************ Function prototypes ************************/
+void arena_init(Arena *);
+void *arena_alloc(Arena *, size_t);
+void arena_rewind(Arena *);
+void arena_destroy(Arena *);
+size_t arena_capacity(uint);
+int arena_push(Arena *, List *, Item);
+#endif
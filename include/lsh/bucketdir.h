@@ -0,0 +1,55 @@
+/**
+ * @file bucketdir.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of structures and functions for bucket directories,
+ *        growable hash maps from 64-bit keys to bucket numbers
+ */
+#ifndef BUCKETDIR_H
+#define BUCKETDIR_H
+
+#include "types.h"
+
+#define BUCKETDIR_GROUP_SIZE 16 //Control bytes compared at once
+#define BUCKETDIR_MIN_CAPACITY 16 //Smallest number of slots (one group)
+#define BUCKETDIR_MAX_LOAD 0.875 //Load factor that triggers growth
+#define BUCKETDIR_EMPTY 0x80 //Control byte of an empty slot
+#define BUCKETDIR_BUSY 0xFE //Control byte of a slot being claimed by a thread
+
+typedef struct BucketDirSlot {
+     ullong key;
+     uint bucket;
+} BucketDirSlot;
+
+typedef struct BucketDir {
+     uint capacity;
+     uint size;
+     uchar *ctrl;
+     BucketDirSlot *slots;
+} BucketDir;
+
+/************************ Function prototypes ************************/
+void bucketdir_init(BucketDir *);
+BucketDir bucketdir_create(uint);
+void bucketdir_clear(BucketDir *);
+void bucketdir_destroy(BucketDir *);
+uint bucketdir_find(BucketDir *, ullong);
+int bucketdir_grow(BucketDir *);
+int bucketdir_insert(BucketDir *, ullong, uint, uint *);
+int bucketdir_assign(BucketDir *, ullong, uint);
+int bucketdir_reserve(BucketDir *, uint);
+uint bucketdir_insert_concurrent(BucketDir *, ullong, uint *);
+#endif
@@ -22,6 +22,9 @@
 
 #include "types.h"
 #include "listdb.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "locations.h"
 
 
 typedef struct {
@@ -32,6 +35,7 @@ typedef struct {
 typedef struct BucketL1 {
      ullong hash_value;
      List items;
+     uint position;
 } BucketL1;
 
 typedef struct HashTableL1 {
@@ -43,13 +47,17 @@ typedef struct HashTableL1 {
      uint *number_of_samples;
      BucketL1 *buckets;
      List used_buckets;
-     uint *a;
-     uint *b;
+     Item *storage;
+     Arena arena;
+     BucketDir directory;
+     uint number_of_buckets;
+     ullong *a;
 } HashTableL1;
 
 typedef struct HashIndexL1 {
 	uint number_of_tables;
 	HashTableL1 *hash_tables;
+	Locations locations;
 } HashIndexL1;
 
 /************************ Function prototypes ************************/
@@ -58,15 +66,31 @@ void l1lsh_print_table(HashTableL1 *);
 void l1lsh_rng_init(unsigned long long);
 void l1lsh_init(HashTableL1 *);
 void l1lsh_generate_sample_bits(uint, uint, uint, SampleBits *, uint *);
+void l1lsh_generate_functions(HashTableL1 *);
 HashTableL1 l1lsh_create(uint, uint, uint, uint);
 void l1lsh_destroy(HashTableL1 *);
 void l1lsh_erase_from_list(List *, HashTableL1 *);
 void l1lsh_erase_from_index(uint, HashTableL1 *);
 void l1lsh_clear_table(HashTableL1 *);
 void l1lsh_destroy(HashTableL1 *);
-void l1lsh_compute_hash_value(List *, HashTableL1 *, uint *, uint *);
+ullong l1lsh_compute_hash_value(List *, HashTableL1 *);
+uint l1lsh_probe(HashTableL1 *, ullong);
 uint l1lsh_get_index(List *, HashTableL1 *);
+int l1lsh_store_entry(uint, Item, HashTableL1 *);
+int l1lsh_store_at(uint, uint, HashTableL1 *);
 uint l1lsh_store_list(List *, uint, HashTableL1 *);
-void l1lsh_store_listdb(ListDB *, HashTableL1 *, uint *);
+int l1lsh_store_listdb(ListDB *, HashTableL1 *, uint *);
+void l1lsh_discard_counts(HashTableL1 *);
+int l1lsh_layout_buckets(HashTableL1 *, uint *, uint, uint, uint);
+int l1lsh_store_listdb_bulk(ListDB *, HashTableL1 *, uint *);
+int l1lsh_store_listdb_parallel(ListDB *, HashTableL1 *, uint *, uint);
 int l1lsh_sample_bit_compare(const void *, const void *);
+void l1lsh_index_init(HashIndexL1 *);
+HashIndexL1 l1lsh_index_create(uint, uint, uint, uint, uint);
+void l1lsh_index_destroy(HashIndexL1 *);
+int l1lsh_index_build(HashIndexL1 *, ListDB *);
+List l1lsh_index_query(HashIndexL1 *, List *);
+void l1lsh_index_compact(HashIndexL1 *);
+int l1lsh_index_delete(HashIndexL1 *, uint);
+int l1lsh_index_update(HashIndexL1 *, uint, List *);
 #endif
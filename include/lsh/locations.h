@@ -0,0 +1,55 @@
+/**
+ * @file locations.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of structures and functions to keep track of the
+ *        buckets where each ID of a multi-table index is stored
+ */
+#ifndef LOCATIONS_H
+#define LOCATIONS_H
+
+#include <stddef.h>
+#include "types.h"
+#include "array_lists.h"
+
+#define LOCATIONS_MIN_CAPACITY 1024 //Smallest number of IDs allocated
+#define LOCATIONS_MAX_STALE 0.25 //Fraction of stale entries that triggers compaction
+
+typedef struct Locations {
+     uint number_of_tables;
+     uint size;
+     uint capacity;
+     uint *buckets;
+     uint *versions;
+     uchar *deleted;
+     size_t number_of_entries;
+     size_t number_of_stale;
+} Locations;
+
+/************************ Function prototypes ************************/
+void locations_init(Locations *, uint);
+void locations_destroy(Locations *);
+int locations_reserve(Locations *, uint);
+int locations_entry(Locations *, uint, uint, uint, Item *);
+int locations_store(Locations *, uint, uint, uint, Item *);
+int locations_delete(Locations *, uint);
+void locations_undelete(Locations *, uint);
+int locations_is_valid(Locations *, Item, uint, uint);
+int locations_need_compaction(Locations *);
+void locations_filter(Locations *, uint, uint, List *);
+void locations_append(Locations *, uint, uint, List *, List *);
+void locations_compacted(Locations *);
+#endif
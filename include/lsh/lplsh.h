@@ -22,11 +22,15 @@
 
 #include "types.h"
 #include "listdb.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "locations.h"
 #include "vectordb.h"
 
 typedef struct BucketLP {
      ullong hash_value;
      List items;
+     uint position;
 } BucketLP;
 
 typedef struct HashTableLP {
@@ -38,13 +42,17 @@ typedef struct HashTableLP {
      double *bval;
      BucketLP *buckets;
      List used_buckets;
-     uint *a;
-     uint *b;
+     Item *storage;
+     Arena arena;
+     BucketDir directory;
+     uint number_of_buckets;
+     ullong *a;
 } HashTableLP;
 
 typedef struct HashIndexLP {
 	uint number_of_tables;
 	HashTableLP *hash_tables;
+	Locations locations;
 } HashIndexLP;
 
 /************************ Function prototypes ************************/
@@ -57,6 +65,7 @@ void lplsh_rng_init(unsigned long long);
 void lplsh_init(HashTableLP *);
 void lplsh_generate_random_values(uint, uint, double, double *, double *,
                                   double (*)(void));
+void lplsh_generate_functions(HashTableLP *, double (*)(void));
 HashTableLP lplsh_create(uint, uint, uint, double);
 void lplsh_destroy(HashTableLP *);
 void lplsh_erase_from_list(List *, HashTableLP *);
@@ -64,8 +73,23 @@ void lplsh_erase_from_index(uint, HashTableLP *);
 void lplsh_clear_table(HashTableLP *);
 void lplsh_destroy(HashTableLP *);
 ullong lplsh_compute_hash_value(Vector *, double *, double, double);
-void lplsh_univhash(Vector *, HashTableLP *, uint *, uint *);
+ullong lplsh_univhash(Vector *, HashTableLP *);
+uint lplsh_probe(HashTableLP *, ullong);
 uint lplsh_get_index(Vector *, HashTableLP *);
+int lplsh_store_entry(uint, Item, HashTableLP *);
+int lplsh_store_at(uint, uint, HashTableLP *);
 uint lplsh_store_vector(Vector *, uint, HashTableLP *);
-void lplsh_store_vectordb(VectorDB *, HashTableLP *, uint *);
+int lplsh_store_vectordb(VectorDB *, HashTableLP *, uint *);
+void lplsh_discard_counts(HashTableLP *);
+int lplsh_layout_buckets(HashTableLP *, uint *, uint, uint, uint);
+int lplsh_store_vectordb_bulk(VectorDB *, HashTableLP *, uint *);
+int lplsh_store_vectordb_parallel(VectorDB *, HashTableLP *, uint *, uint);
+void lplsh_index_init(HashIndexLP *);
+HashIndexLP lplsh_index_create(uint, uint, uint, uint, double, double (*)(void));
+void lplsh_index_destroy(HashIndexLP *);
+int lplsh_index_build(HashIndexLP *, VectorDB *);
+List lplsh_index_query(HashIndexLP *, Vector *);
+void lplsh_index_compact(HashIndexLP *);
+int lplsh_index_delete(HashIndexLP *, uint);
+int lplsh_index_update(HashIndexLP *, uint, Vector *);
 #endif
@@ -0,0 +1,617 @@
+/**
+ * @file lshtable.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Hash table engine shared by the MinHash, L1LSH and LPLSH hash
+ *        tables. This file is a template: it has no include guard and is
+ *        included once by each hash family, after defining
+ *
+ *        LSH_PREFIX      prefix of the generated functions (mh, l1lsh, lplsh)
+ *        LSH_TABLE       hash table type (with buckets, used_buckets,
+ *                        storage, arena, directory and number_of_buckets)
+ *        LSH_BUCKET      bucket type (with hash_value, items and position)
+ *        LSH_INDEX       multi-table index type (with number_of_tables,
+ *                        hash_tables and locations)
+ *        LSH_OBJECT      type of the hashed objects (List or Vector)
+ *        LSH_OBJECT_NAME name of the objects in function names (list, vector)
+ *        LSH_DB          type of the database of objects
+ *        LSH_DB_NAME     name of the database in function names
+ *        LSH_DB_OBJECTS  field of the database holding its objects
+ *        LSH_KEY(object, hash_table) expression computing the 2nd-level
+ *                        hash value of an object
+ *
+ *        The family's clear_table function must be declared. Since the key
+ *        expression is expanded in the generated loops, the hash of each
+ *        family is inlined into probing, bulk and parallel builds instead of
+ *        being reached through a function pointer. The macros are undefined
+ *        at the end of the file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "array_lists.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "locations.h"
+#include "parallel.h"
+
+#define LSH_CONCAT_(a, b) a ## b
+#define LSH_CONCAT(a, b) LSH_CONCAT_(a, b)
+#define LSH_NAME(name) LSH_CONCAT(LSH_PREFIX, LSH_CONCAT(_, name))
+#define LSH_DB_FUNCTION(name, suffix) LSH_NAME(LSH_CONCAT(name, LSH_CONCAT(LSH_DB_NAME, suffix)))
+
+/**
+ * @brief Appends a bucket to the list of used buckets
+ *
+ * @param hash_table Hash table structure
+ * @param index Index of the bucket
+ */
+static void LSH_NAME(use_bucket)(LSH_TABLE *hash_table, uint index)
+{
+     Item new_used_bucket = {index, 1};
+
+     hash_table->buckets[index].position = hash_table->used_buckets.size;
+     list_push(&hash_table->used_buckets, new_used_bucket);
+}
+
+/**
+ * @brief Removes a bucket from the list of used buckets in O(1) by moving
+ *        the last used bucket to its position
+ *
+ * @param hash_table Hash table structure
+ * @param index Index of the bucket
+ */
+static void LSH_NAME(release_bucket)(LSH_TABLE *hash_table, uint index)
+{
+     uint position = hash_table->buckets[index].position;
+
+     if (position == LSH_NO_INDEX)
+          return;
+
+     Item last = hash_table->used_buckets.data[--hash_table->used_buckets.size];
+     hash_table->used_buckets.data[position] = last;
+     hash_table->buckets[last.item].position = position;
+     hash_table->buckets[index].position = LSH_NO_INDEX;
+}
+
+/**
+ * @brief Removes items in a given bucket of the hash table
+ *
+ * @param index Index of the bucket to be removed
+ * @param hash_table Hash table structure
+ */
+void LSH_NAME(erase_from_index)(uint index, LSH_TABLE *hash_table)
+{  
+     if (index < hash_table->number_of_buckets){
+          // empties bucket (it stays in the directory and its IDs are
+          // released when the arena is rewound)
+          list_init(&hash_table->buckets[index].items);
+
+          // moves the last used bucket to the position of the erased one
+          LSH_NAME(release_bucket)(hash_table, index);
+     } else {
+          printf("Index %u out of range! Number of buckets is %u", index, hash_table->number_of_buckets);
+     }
+}
+
+/**
+ * @brief Finds the bucket of a 2nd-level hash value, creating it if the
+ *        value is new. The bucket directory maps hash values to bucket
+ *        numbers and grows with the number of buckets, and the array of
+ *        buckets is doubled when it is full, so the table never fills up.
+ *        Bucket numbers are stable while the table is not cleared.
+ *
+ * @param hash_table Hash table structure
+ * @param hash_value 2nd-level hash value
+ *
+ * @return Index of the bucket, LSH_NO_INDEX if memory could not be allocated
+ */ 
+uint LSH_NAME(probe)(LSH_TABLE *hash_table, ullong hash_value)
+{
+     uint index;
+
+     if (hash_table->number_of_buckets == hash_table->table_size){ // array of buckets is full
+          uint table_size = hash_table->table_size ? 2 * hash_table->table_size : BUCKETDIR_MIN_CAPACITY;
+          LSH_BUCKET *buckets = (LSH_BUCKET *) realloc(hash_table->buckets, (size_t) table_size * sizeof(LSH_BUCKET));
+          if (buckets == NULL)
+               return LSH_NO_INDEX;
+          memset(buckets + hash_table->table_size, 0,
+                 (size_t) (table_size - hash_table->table_size) * sizeof(LSH_BUCKET));
+          hash_table->buckets = buckets;
+          hash_table->table_size = table_size;
+     }
+
+     if (bucketdir_insert(&hash_table->directory, hash_value, hash_table->number_of_buckets, &index) != LSH_OK)
+          return LSH_NO_INDEX;
+
+     if (index == hash_table->number_of_buckets){ // new bucket
+          hash_table->buckets[index].hash_value = hash_value;
+          list_init(&hash_table->buckets[index].items);
+          hash_table->buckets[index].position = LSH_NO_INDEX;
+          hash_table->number_of_buckets++;
+     }
+     
+     return index;
+}
+
+/**
+ * @brief Computes the bucket of an object
+ *
+ * @param object Object to be hashed
+ * @param hash_table Hash table structure
+ *
+ * @return index of the hash table (LSH_NO_INDEX on failure)
+ */ 
+uint LSH_NAME(get_index)(LSH_OBJECT *object, LSH_TABLE *hash_table)
+{
+     return LSH_NAME(probe)(hash_table, LSH_KEY(object, hash_table));
+}
+
+/**
+ * @brief Checks that IDs can be stored one at a time in a hash table. A
+ *        table built in bulk keeps its IDs in a contiguous array and must
+ *        be cleared first; it is checked before probing so that a rejected
+ *        ID does not leave an empty bucket behind.
+ *
+ * @param hash_table Hash table
+ *
+ * @return LSH_OK, or LSH_INVALID if the table was built in bulk and not cleared
+ */
+static int LSH_NAME(check_storage)(LSH_TABLE *hash_table)
+{
+     if (hash_table->storage != NULL){
+          fprintf(stderr,"Error: Hash tables built in bulk must be cleared before storing\n");
+          return LSH_INVALID;
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Stores an entry in a given bucket of the hash table.
+ *
+ * @param index Index of the bucket
+ * @param entry Entry (item: ID of the object)
+ * @param hash_table Hash table
+ *
+ * @return LSH_OK, LSH_NO_MEMORY if the bucket could not be computed, or
+ *         LSH_INVALID if the table was built in bulk and not cleared
+ */ 
+int LSH_NAME(store_entry)(uint index, Item entry, LSH_TABLE *hash_table)
+{
+     if (index == LSH_NO_INDEX)
+          return LSH_NO_MEMORY;
+
+     if (LSH_NAME(check_storage)(hash_table) != LSH_OK)
+          return LSH_INVALID;
+
+     // store entry in the hash table
+     if (arena_push(&hash_table->arena, &hash_table->buckets[index].items, entry) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     if (hash_table->buckets[index].position == LSH_NO_INDEX) // mark used bucket
+          LSH_NAME(use_bucket)(hash_table, index);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Stores an ID in a given bucket of the hash table.
+ *
+ * @param index Index of the bucket
+ * @param id ID of the object
+ * @param hash_table Hash table
+ *
+ * @return LSH_OK, LSH_NO_MEMORY if the bucket could not be computed, or
+ *         LSH_INVALID if the table was built in bulk and not cleared
+ */ 
+int LSH_NAME(store_at)(uint index, uint id, LSH_TABLE *hash_table)
+{
+     Item new_item = {id, 1};
+
+     return LSH_NAME(store_entry)(index, new_item, hash_table);
+}
+
+/**
+ * @brief Stores an object in the hash table.
+ *
+ * @param object Object to be hashed
+ * @param id ID of the object
+ * @param hash_table Hash table
+ *
+ * @return Index of the bucket, LSH_NO_INDEX if the object could not be stored
+ */ 
+uint LSH_NAME(LSH_CONCAT(store_, LSH_OBJECT_NAME))(LSH_OBJECT *object, uint id, LSH_TABLE *hash_table)
+{
+     if (LSH_NAME(check_storage)(hash_table) != LSH_OK)
+          return LSH_NO_INDEX;
+
+     // get index of the hash table
+     uint index = LSH_NAME(get_index)(object, hash_table);
+     if (LSH_NAME(store_at)(index, id, hash_table) != LSH_OK)
+          return LSH_NO_INDEX;
+
+     return index;
+}
+
+/**
+ * @brief Discards the bucket sizes counted by a bulk build that could
+ *        not be completed and empties the hash table.
+ *
+ * @param hash_table Hash table
+ */
+void LSH_NAME(discard_counts)(LSH_TABLE *hash_table)
+{
+     uint i;
+
+     for (i = 0; i < hash_table->number_of_buckets; i++)
+          hash_table->buckets[i].items.size = 0;
+     LSH_NAME(clear_table)(hash_table);
+}
+
+/**
+ * @brief Lays out the IDs stored in a hash table in a single contiguous
+ *        array (counting sort). The number of IDs of each bucket must have
+ *        been counted in its items.size, and indices holds the bucket of
+ *        each ID (LSH_NO_INDEX for IDs that are not stored). Each bucket then
+ *        becomes a view of consecutive IDs of the array, so scanning a
+ *        bucket is sequential and no memory is allocated per ID.
+ *
+ * @param hash_table Hash table
+ * @param indices Bucket index of each ID
+ * @param size Number of IDs
+ * @param number_of_ids Number of stored IDs
+ * @param number_of_buckets Number of used buckets
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int LSH_NAME(layout_buckets)(LSH_TABLE *hash_table, uint *indices, uint size, uint number_of_ids,
+                             uint number_of_buckets)
+{
+     uint i;
+     Item *next;
+
+     hash_table->storage = (Item *) arena_alloc(&hash_table->arena, (size_t) number_of_ids * sizeof(Item));
+     hash_table->used_buckets.data = (Item *) malloc(number_of_buckets * sizeof(Item));
+     hash_table->used_buckets.size = 0;
+     if ((hash_table->storage == NULL && number_of_ids > 0) ||
+         (hash_table->used_buckets.data == NULL && number_of_buckets > 0)){
+          LSH_NAME(discard_counts)(hash_table);
+          return LSH_NO_MEMORY;
+     }
+
+     next = hash_table->storage;
+     for (i = 0; i < size; i++){
+          if (indices[i] == LSH_NO_INDEX)
+               continue;
+
+          LSH_BUCKET *bucket = &hash_table->buckets[indices[i]];
+          if (bucket->items.data == NULL){ // first ID of the bucket: reserves its range
+               bucket->items.data = next;
+               next += bucket->items.size;
+               bucket->items.size = 0;
+
+               Item new_used_bucket = {indices[i], 1};
+               bucket->position = hash_table->used_buckets.size;
+               hash_table->used_buckets.data[hash_table->used_buckets.size++] = new_used_bucket;
+          }
+
+          Item new_item = {i, 1};
+          bucket->items.data[bucket->items.size++] = new_item;
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Stores the objects of a database in the hash table in bulk. All
+ *        the bucket indices are computed first, then the IDs are laid out
+ *        contiguously by layout_buckets. The table must be empty and cannot
+ *        receive more IDs until it is cleared.
+ *
+ * @param database Database of objects to be hashed
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty objects)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (the table is not empty)
+ */ 
+int LSH_DB_FUNCTION(store_, _bulk)(LSH_DB *database, LSH_TABLE *hash_table, uint *indices)
+{
+     uint i;
+     uint number_of_ids = 0, number_of_buckets = 0;
+
+     if (hash_table->storage != NULL || hash_table->used_buckets.size != 0){
+          fprintf(stderr,"Error: Bulk build requires an empty hash table\n");
+          return LSH_INVALID;
+     }
+
+     // computes bucket indices and counts the IDs of each bucket
+     for (i = 0; i < database->size; i++){
+          LSH_OBJECT *object = &database->LSH_DB_OBJECTS[i];
+          if (object->size == 0){
+               indices[i] = LSH_NO_INDEX;
+               continue;
+          }
+          indices[i] = LSH_NAME(probe)(hash_table, LSH_KEY(object, hash_table));
+          if (indices[i] == LSH_NO_INDEX){
+               LSH_NAME(discard_counts)(hash_table);
+               return LSH_NO_MEMORY;
+          }
+          if (hash_table->buckets[indices[i]].items.size++ == 0)
+               number_of_buckets++;
+          number_of_ids++;
+     }
+
+     return LSH_NAME(layout_buckets)(hash_table, indices, database->size, number_of_ids, number_of_buckets);
+}
+
+/**
+ * @brief Hashes a range of objects in a parallel build (see
+ *        parallel_hash_ids). The data of the shared state holds the
+ *        database and the hash table.
+ */
+static void LSH_NAME(parallel_hash_range)(void *arg, uint start, uint end)
+{
+     uint i;
+     ParallelHashing *hashing = (ParallelHashing *) arg;
+     void **source = (void **) hashing->data;
+     LSH_DB *database = (LSH_DB *) source[0];
+     LSH_TABLE *hash_table = (LSH_TABLE *) source[1];
+
+     for (i = start; i < end; i++){
+          LSH_OBJECT *object = &database->LSH_DB_OBJECTS[i];
+          parallel_insert(hashing, i, object->size == 0 ? PARALLEL_NO_KEY : LSH_KEY(object, hash_table));
+     }
+}
+
+/**
+ * @brief Lays out the buckets computed by parallel_hash_ids in the hash
+ *        table. Buckets are numbered in the order of their first ID, so
+ *        the table is the same as the one built in bulk by a single thread.
+ *
+ * @param hash_table Hash table
+ * @param buckets Keys and offsets of the buckets
+ * @param indices Bucket index of each ID
+ * @param size Number of IDs
+ * @param number_of_threads Number of threads
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+static int LSH_NAME(layout_parallel)(LSH_TABLE *hash_table, ParallelBuckets *buckets, uint *indices,
+                                     uint size, uint number_of_threads)
+{
+     uint i;
+
+     if (buckets->number_of_buckets > hash_table->table_size){
+          LSH_BUCKET *new_buckets = (LSH_BUCKET *) realloc(hash_table->buckets,
+                                                           (size_t) buckets->number_of_buckets * sizeof(LSH_BUCKET));
+          if (new_buckets == NULL)
+               return LSH_NO_MEMORY;
+          hash_table->buckets = new_buckets;
+          hash_table->table_size = buckets->number_of_buckets;
+     }
+
+     hash_table->storage = (Item *) arena_alloc(&hash_table->arena, (size_t) buckets->number_of_ids * sizeof(Item));
+     hash_table->used_buckets.data = (Item *) malloc(buckets->number_of_buckets * sizeof(Item));
+     if ((hash_table->storage == NULL && buckets->number_of_ids > 0) ||
+         (hash_table->used_buckets.data == NULL && buckets->number_of_buckets > 0))
+          return LSH_NO_MEMORY;
+
+     if (parallel_layout_ids(buckets, indices, size, hash_table->storage, number_of_threads) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     for (i = 0; i < buckets->number_of_buckets; i++){
+          hash_table->buckets[i].hash_value = buckets->keys[i];
+          hash_table->buckets[i].items.data = hash_table->storage + buckets->offsets[i];
+          hash_table->buckets[i].items.size = buckets->offsets[i + 1] - buckets->offsets[i];
+          hash_table->buckets[i].position = i;
+          hash_table->used_buckets.data[i].item = i;
+          hash_table->used_buckets.data[i].freq = 1;
+     }
+     hash_table->used_buckets.size = buckets->number_of_buckets;
+     hash_table->number_of_buckets = buckets->number_of_buckets;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Stores the objects of a database in the hash table from several
+ *        threads. Each thread hashes a range of objects and inserts their
+ *        keys in the shared bucket directory, and the IDs are then laid out
+ *        contiguously as in the bulk build (see parallel_hash_ids). The
+ *        resulting table does not depend on the number of threads. The
+ *        table must be empty and cannot receive more IDs until it is
+ *        cleared.
+ *
+ * @param database Database of objects to be hashed
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty objects)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (the table is not empty)
+ */
+int LSH_DB_FUNCTION(store_, _parallel)(LSH_DB *database, LSH_TABLE *hash_table, uint *indices,
+                                       uint number_of_threads)
+{
+     int status;
+     ParallelBuckets buckets;
+     void *source[2] = {database, hash_table};
+
+     if (hash_table->storage != NULL || hash_table->used_buckets.size != 0){
+          fprintf(stderr,"Error: Bulk build requires an empty hash table\n");
+          return LSH_INVALID;
+     }
+
+     if (bucketdir_reserve(&hash_table->directory, database->size) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     status = parallel_hash_ids(&hash_table->directory, database->size, LSH_NAME(parallel_hash_range),
+                                source, number_of_threads, indices, &buckets);
+     if (status == LSH_OK)
+          status = LSH_NAME(layout_parallel)(hash_table, &buckets, indices, database->size, number_of_threads);
+     parallel_buckets_destroy(&buckets);
+
+     if (status != LSH_OK)
+          LSH_NAME(clear_table)(hash_table);
+
+     return status;
+}
+
+/**
+ * @brief Stores an ID in the given bucket of each table of an index and
+ *        records its locations. The entries of all the tables are stored
+ *        before any location is recorded, and the ones already stored are
+ *        removed if another fails, so a failed store leaves the buckets
+ *        and locations of the index as they were.
+ *
+ * @param index Hash index structure
+ * @param id ID of the object (reserved in the locations of the index)
+ * @param buckets Bucket of the object in each table
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (see store_entry)
+ */
+static int LSH_NAME(index_store_buckets)(LSH_INDEX *index, uint id, uint *buckets)
+{
+     uint j;
+     Item entry;
+     int status = LSH_OK;
+
+     for (j = 0; j < index->number_of_tables; j++)
+          if (locations_entry(&index->locations, id, j, buckets[j], &entry)){
+               status = LSH_NAME(store_entry)(buckets[j], entry, &index->hash_tables[j]);
+               if (status != LSH_OK)
+                    break;
+          }
+
+     if (status != LSH_OK){
+          // the entries just stored are the last ones of their buckets
+          while (j-- > 0)
+               if (locations_entry(&index->locations, id, j, buckets[j], &entry)){
+                    LSH_TABLE *hash_table = &index->hash_tables[j];
+                    List *items = &hash_table->buckets[buckets[j]].items;
+                    if (--items->size == 0)
+                         LSH_NAME(erase_from_index)(buckets[j], hash_table);
+               }
+          return status;
+     }
+
+     for (j = 0; j < index->number_of_tables; j++)
+          locations_store(&index->locations, id, j, buckets[j], &entry);
+     locations_undelete(&index->locations, id);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Moves the IDs of the used buckets of a table to a new arena and
+ *        frees the old one, returning the memory of removed IDs and of the
+ *        copies left behind by buckets that grew. The IDs are copied to a
+ *        single allocation with the capacities expected by arena_push. If
+ *        it cannot be allocated, the table keeps its arena.
+ *
+ * @param hash_table Hash table
+ */
+static void LSH_NAME(renew_arena)(LSH_TABLE *hash_table)
+{
+     uint i;
+     size_t number_of_items = 0;
+     Item *next;
+     Arena arena;
+
+     for (i = 0; i < hash_table->used_buckets.size; i++)
+          number_of_items += arena_capacity(hash_table->buckets[hash_table->used_buckets.data[i].item].items.size);
+
+     arena_init(&arena);
+     if (number_of_items > 0){
+          next = (Item *) arena_alloc(&arena, number_of_items * sizeof(Item));
+          if (next == NULL)
+               return;
+          for (i = 0; i < hash_table->used_buckets.size; i++){
+               List *items = &hash_table->buckets[hash_table->used_buckets.data[i].item].items;
+               memcpy(next, items->data, items->size * sizeof(Item));
+               items->data = next;
+               next += arena_capacity(items->size);
+          }
+     }
+
+     arena_destroy(&hash_table->arena);
+     hash_table->arena = arena;
+}
+
+/**
+ * @brief Removes the stale entries of all the buckets of an index (see
+ *        locations.c). Buckets left empty are removed from the list of
+ *        used buckets of their table, and the valid entries are moved to a
+ *        new arena, so the memory of the tables follows the number of
+ *        stored IDs however many times they are updated.
+ *
+ * @param index Hash index structure
+ */
+void LSH_NAME(index_compact)(LSH_INDEX *index)
+{
+     uint i, j;
+
+     for (j = 0; j < index->number_of_tables; j++){
+          LSH_TABLE *hash_table = &index->hash_tables[j];
+          // erasing a bucket moves the last used bucket to its position
+          for (i = hash_table->used_buckets.size; i > 0; i--){
+               uint bucket = hash_table->used_buckets.data[i - 1].item;
+               locations_filter(&index->locations, j, bucket, &hash_table->buckets[bucket].items);
+               if (hash_table->buckets[bucket].items.size == 0)
+                    LSH_NAME(erase_from_index)(bucket, hash_table);
+          }
+          if (hash_table->storage == NULL) // IDs of bulk builds are not in buckets of their own
+               LSH_NAME(renew_arena)(hash_table);
+     }
+     locations_compacted(&index->locations);
+}
+
+/**
+ * @brief Deletes an object from all the tables of an index in O(number of
+ *        tables). Its entries are left in the buckets as stale entries,
+ *        which queries skip, and the index is compacted once stale entries
+ *        exceed LOCATIONS_MAX_STALE of all the entries.
+ *
+ * @param index Hash index structure
+ * @param id ID of the object
+ *
+ * @return LSH_OK, or LSH_INVALID if the ID is not stored
+ */
+int LSH_NAME(index_delete)(LSH_INDEX *index, uint id)
+{
+     int status = locations_delete(&index->locations, id);
+
+     if (status == LSH_OK && locations_need_compaction(&index->locations))
+          LSH_NAME(index_compact)(index);
+
+     return status;
+}
+
+#undef LSH_DB_FUNCTION
+#undef LSH_NAME
+#undef LSH_CONCAT
+#undef LSH_CONCAT_
+#undef LSH_PREFIX
+#undef LSH_TABLE
+#undef LSH_BUCKET
+#undef LSH_INDEX
+#undef LSH_OBJECT
+#undef LSH_OBJECT_NAME
+#undef LSH_DB
+#undef LSH_DB_NAME
+#undef LSH_DB_OBJECTS
+#undef LSH_KEY
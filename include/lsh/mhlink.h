@@ -23,9 +23,28 @@
 
 #include "minhash.h"
 
+typedef struct MHLinkOptions {
+     uint max_bucket_size; //Largest number of IDs in a bucket (0 for no limit)
+     uint bucket_policy; //MH_BUCKET_KEEP, MH_BUCKET_SAMPLE, MH_BUCKET_SPLIT or MH_BUCKET_STOP
+     uint number_of_threads; //Threads storing lists in the hash tables (0 for all processors)
+} MHLinkOptions;
+
+int mhlink_store_listdb(ListDB *, HashTableMH *, uint *, MHLinkOptions *);
+HashTableMH mhlink_create_table(uint, uint, uint, uint, MHLinkOptions *);
 ListDB mhlink_make_model(ListDB *, ListDB *);
+void mhlink_merge_neighbor(ListDB *, uint, uint, uint *, uint *);
 void mhlink_add_neighbors(ListDB *, ListDB *, uint , List *, uint *, uint *, 
 			  double (*)(List *, List *), double);
+void mhlink_add_bbit_neighbors(BbitSignatureDB *, ListDB *, uint, List *, uint *, uint *, double);
+void mhlink_link_table(ListDB *, ListDB *, HashTableMH *, uint *, uint *, uint *,
+                       double (*)(List *, List *), BbitSignatureDB *, double);
+ListDB mhlink_cluster_scheme(ListDB *, uint, uint, uint, uint, double *,
+                             double (*)(List *, List *), double, uint, MHLinkOptions *);
+ListDB mhlink_cluster_signatures(ListDB *, SignatureDB *, uint, uint,
+                                 double (*)(List *, List *), double, uint, MHLinkOptions *);
+ListDB mhlink_cluster_cached(ListDB *, uint, uint, uint, uint, ullong, char *,
+                             double (*)(List *, List *), double, uint, MHLinkOptions *);
+ListDB mhlink_cluster_bbit(ListDB *, BbitSignatureDB *, uint, uint, double, uint, MHLinkOptions *);
 ListDB mhlink_cluster(ListDB *, uint, uint, uint, double (*)(List *, List *), double, uint);
 ListDB mhlink_cluster_weighted(ListDB *, uint, uint, uint, double *,
                                double (*)(List *, List *), double, uint);
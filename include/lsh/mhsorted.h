@@ -0,0 +1,68 @@
+/**
+ * @file mhsorted.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of structures and functions for sorted MinHash
+ *        indexes, where each table is an array of (band key, ID) pairs
+ *        sorted by key
+ */
+#ifndef MHSORTED_H
+#define MHSORTED_H
+
+#include "minhash.h"
+
+#define MHSORTED_MAGIC "LSHSRT" //Magic string of sorted index files
+#define MHSORTED_VERSION 2 //Version of the sorted index file format
+#define MHSORTED_RADIX_BITS 11 //Bits of the key sorted in each pass
+#define MHSORTED_RADIX_PASSES 6 //Passes needed to sort 61-bit keys
+#define MHSORTED_INTERPOLATION_STEPS 6 //Interpolation steps before bisection
+#define MHSORTED_LINEAR_SEARCH 8 //Range size where searching becomes linear
+
+typedef struct SortedIndexMH {
+	uint number_of_tables;
+	uint tuple_size;
+	uint size;
+	HashTableMH sketcher;
+	ullong *a;
+	ullong *keys;
+	uint *ids;
+	void *mapping;
+	size_t mapping_size;
+} SortedIndexMH;
+
+typedef struct SortedIndexFileHeader {
+	char magic[8];
+	uint version;
+	uint scheme;
+	uint number_of_tables;
+	uint tuple_size;
+	uint dim;
+	uint size;
+	uint weighted; //1 if the sketcher had item weights, which are not saved
+	uint reserved; //Keeps the tables 8-byte aligned
+} SortedIndexFileHeader;
+
+/************************ Function prototypes ************************/
+void mhsorted_init(SortedIndexMH *);
+SortedIndexMH mhsorted_create(uint, uint, uint, uint, double *);
+void mhsorted_destroy(SortedIndexMH *);
+void mhsorted_radix_sort(ullong *, uint *, ullong *, uint *, uint);
+int mhsorted_build(SortedIndexMH *, ListDB *);
+uint mhsorted_search(ullong *, uint, ullong);
+List mhsorted_query(SortedIndexMH *, List *);
+int mhsorted_save(char *, SortedIndexMH *);
+SortedIndexMH mhsorted_load(char *, double *);
+#endif
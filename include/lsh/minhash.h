@@ -20,7 +20,27 @@
 #ifndef MINHASH_H
 #define MINHASH_H
 
+#include <stddef.h>
 #include "listdb.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "locations.h"
+
+#define MH_STACK_TUPLE_SIZE 64 //Largest tuple handled without heap scratch space
+
+#define MH_PERMUTATIONS 0 //Random values stored in a tuple_size x dim table
+#define MH_HASHED 1 //Random values computed on demand from seeded hash functions
+#define MH_OPH 2 //One permutation hashing with optimal densification
+#define MH_WEIGHTED 3 //Consistent weighted sampling (ICWS) on item frequencies
+
+#define MH_BUCKET_KEEP 0 //Buckets grow without limit
+#define MH_BUCKET_SAMPLE 1 //Overflowing buckets keep a random sample of their IDs
+#define MH_BUCKET_SPLIT 2 //Overflowing buckets are split by extra MinHash values
+#define MH_BUCKET_STOP 3 //Overflowing buckets are emptied and skipped
+#define MH_MAX_SPLITS 4 //Extra MinHash values used to split a bucket
+
+#define MH_SIGNATURE_MAGIC "LSHSIG" //Magic string of signature files
+#define MH_SIGNATURE_VERSION 1 //Version of the signature file format
 
 typedef struct RandomValue
 {
@@ -31,23 +51,72 @@ typedef struct RandomValue
 typedef struct BucketMH {
      ullong hash_value;
      List items;
+     uint position;
 } BucketMH;
 
 typedef struct HashTableMH {
 	uint table_size; 
 	uint tuple_size; 
 	uint dim;
+	uint scheme;
 	RandomValue *permutations;
+	ullong *seeds;
 	BucketMH *buckets;
 	List used_buckets;
-	uint *a;
-   uint *b;
-   double *weights;
+	Item *storage;
+	Arena arena;
+	BucketDir directory;
+	uint number_of_buckets;
+	ullong *a;
+	double *weights;
+	uint max_bucket_size;
+	uint bucket_policy;
+	ullong split_seeds[MH_MAX_SPLITS];
+	ullong split_a[MH_MAX_SPLITS];
+	List overflowed;
 } HashTableMH;
 
+typedef struct SignatureDB {
+	uint size;
+	uint number_of_values;
+	ullong *values;
+	void *mapping;
+	size_t mapping_size;
+} SignatureDB;
+
+typedef struct SignatureKey {
+	uint scheme;
+	uint tuple_size;
+	uint number_of_tuples;
+	ullong seed;
+	ullong fingerprint;
+} SignatureKey;
+
+typedef struct SignatureFileHeader {
+	char magic[8];
+	uint version;
+	uint scheme;
+	uint tuple_size;
+	uint number_of_tuples;
+	ullong seed;
+	ullong fingerprint;
+	uint size;
+	uint number_of_values;
+} SignatureFileHeader;
+
+typedef struct BbitSignatureDB {
+	uint size;
+	uint number_of_values;
+	uint bits;
+	uint words_per_row;
+	ullong *words;
+} BbitSignatureDB;
+
 typedef struct HashIndexMH {
 	uint number_of_tables;
 	HashTableMH *hash_tables;
+	HashTableMH sketcher;
+	Locations locations;
 } HashIndexMH;
 
 /************************ Function prototypes ************************/
@@ -56,6 +125,7 @@ void mh_print_table(HashTableMH *);
 void mh_rng_init(unsigned long long);
 void mh_init(HashTableMH *);
 HashTableMH mh_create(uint, uint, uint);
+HashTableMH mh_create_scheme(uint, uint, uint, uint);
 void mh_destroy(HashTableMH *);
 void mh_erase_from_list(List *, HashTableMH *);
 void mh_erase_from_index(uint, HashTableMH *);
@@ -63,13 +133,66 @@ void mh_clear_table(HashTableMH *);
 void mh_destroy(HashTableMH *);
 void mh_generate_permutations(uint, uint, RandomValue *);
 void mh_weight_permutations(uint, uint, RandomValue *, double *);
+void mh_generate_seeds(uint, ullong *);
+void mh_generate_functions(HashTableMH *);
+ullong mh_mix64(ullong);
+ullong mh_hash_item(ullong, uint);
+ullong mh_weighted_key(ullong, double);
 int mh_random_value_compare(const void *, const void *);
-ullong mh_compute_minhash(List *, RandomValue *);
-void mh_univhash(List *, HashTableMH *, uint *, uint *);
+ullong mh_compute_minhash(List *, RandomValue *, uint, uint);
+void mh_compute_minhashes(List *, RandomValue *, uint, ullong *);
+void mh_compute_hashed_minhashes(List *, ullong *, double *, uint, ullong *);
+void mh_compute_oph_minhashes(List *, ullong, double *, uint, ullong *);
+void mh_compute_icws_minhashes(List *, ullong *, double *, uint, ullong *);
+void mh_compute_tuple(List *, HashTableMH *, ullong *);
+ullong mh_univhash_tuple(ullong *, HashTableMH *);
+ullong mh_univhash(List *, HashTableMH *);
+uint mh_probe(HashTableMH *, ullong);
 uint mh_get_index(List *, HashTableMH *);
+uint mh_get_tuple_index(ullong *, HashTableMH *);
+int mh_store_entry(uint, Item, HashTableMH *);
+int mh_store_at(uint, uint, HashTableMH *);
 uint mh_store_list(List *, uint, HashTableMH *);
-void mh_store_listdb(ListDB *, HashTableMH *, uint *);
+uint mh_store_tuple(ullong *, uint, HashTableMH *);
+int mh_store_listdb(ListDB *, HashTableMH *, uint *);
+void mh_discard_counts(HashTableMH *);
+int mh_layout_buckets(HashTableMH *, uint *, uint, uint, uint);
+int mh_store_listdb_bulk(ListDB *, HashTableMH *, uint *);
+int mh_store_signatures_bulk(SignatureDB *, ListDB *, uint, HashTableMH *, uint *);
+int mh_store_listdb_parallel(ListDB *, HashTableMH *, uint *, uint);
+void mh_set_bucket_limit(HashTableMH *, uint, uint);
+ullong mh_split_minhash(List *, ullong);
+int mh_limit_bucket(HashTableMH *, uint, ListDB *, uint *, uint);
+int mh_limit_buckets(HashTableMH *, ListDB *, uint *);
+uint mh_update_tuple(ullong *, uint, uint, HashTableMH *);
+uint mh_update_hashed_minhashes(ullong *, List *, ullong *, double *, uint);
+int mh_update_signature(SignatureDB *, uint, List *, HashTableMH *, HashTableMH *, uint, uint *);
+void mh_signatures_init(SignatureDB *);
+SignatureDB mh_signatures_create(uint, uint);
+void mh_signatures_destroy(SignatureDB *);
+SignatureDB mh_sketch_listdb(ListDB *, HashTableMH *);
+int mh_store_signatures(SignatureDB *, ListDB *, uint, HashTableMH *, uint *);
+ullong mh_listdb_fingerprint(ListDB *);
+int mh_signatures_save(char *, SignatureDB *, SignatureKey *);
+SignatureDB mh_signatures_map(char *, SignatureKey *);
+void mh_bbit_init(BbitSignatureDB *);
+BbitSignatureDB mh_bbit_create(uint, uint, uint);
+void mh_bbit_destroy(BbitSignatureDB *);
+BbitSignatureDB mh_bbit_compress(SignatureDB *, uint);
+uint mh_bbit_get(BbitSignatureDB *, uint, uint);
+uint mh_bbit_matches(BbitSignatureDB *, uint, uint);
+double mh_bbit_estimate(double, uint, double, double);
+double mh_bbit_jaccard(BbitSignatureDB *, uint, uint);
+int mh_store_bbit_signatures(BbitSignatureDB *, ListDB *, uint, HashTableMH *, uint *);
 uint *mh_get_cumulative_frequency(ListDB *, ListDB *);
 ListDB mh_expand_listdb(ListDB *, uint *);
 double *mh_expand_weights(uint, uint *, double *);
+void mh_index_init(HashIndexMH *);
+HashIndexMH mh_index_create(uint, uint, uint, uint, uint, double *);
+void mh_index_destroy(HashIndexMH *);
+int mh_index_build(HashIndexMH *, ListDB *);
+List mh_index_query(HashIndexMH *, List *);
+void mh_index_compact(HashIndexMH *);
+int mh_index_delete(HashIndexMH *, uint);
+int mh_index_update(HashIndexMH *, uint, List *);
 #endif
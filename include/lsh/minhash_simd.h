@@ -0,0 +1,35 @@
+/**
+ * @file minhash_simd.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of vectorized MinHash kernels selected at runtime
+ */
+#ifndef MINHASH_SIMD_H
+#define MINHASH_SIMD_H
+
+#include "minhash.h"
+
+#define MH_KERNEL_SCALAR 0 //Portable scalar loops
+#define MH_KERNEL_AVX2 1 //4 MinHash functions per instruction
+#define MH_KERNEL_AVX512 2 //8 MinHash functions per instruction
+
+/************************ Function prototypes ************************/
+uint mh_simd_detect(void);
+uint mh_simd_get_kernel(void);
+uint mh_simd_set_kernel(uint);
+void mh_simd_compute_minhashes(List *, RandomValue *, uint, ullong *);
+void mh_simd_compute_hashed_minhashes(List *, ullong *, double *, uint, ullong *);
+#endif
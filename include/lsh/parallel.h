@@ -0,0 +1,97 @@
+/**
+ * @file parallel.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Declaration of structures and functions to fill hash tables
+ *        from several threads
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "types.h"
+#include "array_lists.h"
+#include "bucketdir.h"
+
+#define PARALLEL_MAX_THREADS 256 //Largest number of threads started at once
+#define PARALLEL_NO_KEY 18446744073709551615ULL //Key of the IDs that are not stored
+
+typedef void (*ParallelWork)(void *, uint, uint);
+
+typedef struct ParallelTask {
+     ParallelWork work;
+     void *arg;
+     uint start;
+     uint end;
+} ParallelTask;
+
+typedef struct ParallelHashing {
+     BucketDir *dir;
+     void *data;
+     uint *indices;
+     uint *counts;
+     uint *first;
+     uint next_bucket;
+     int status;
+} ParallelHashing;
+
+typedef struct ParallelBuckets {
+     uint number_of_buckets;
+     uint number_of_ids;
+     ullong *keys;
+     uint *offsets;
+} ParallelBuckets;
+
+/**
+ * @brief Inserts the key of an ID in the shared bucket directory, counting
+ *        the IDs of its bucket and keeping the smallest ID of each bucket.
+ *        Called by the workers given to parallel_hash_ids for each ID of
+ *        their range, so the key computation of each hash family can be
+ *        inlined in the loop.
+ *
+ * @param hashing Shared state of the threads
+ * @param id ID
+ * @param key 2nd-level hash value of the ID (PARALLEL_NO_KEY if not stored)
+ */
+static inline void parallel_insert(ParallelHashing *hashing, uint id, ullong key)
+{
+     uint bucket, first;
+
+     if (key == PARALLEL_NO_KEY){
+          hashing->indices[id] = LSH_NO_INDEX;
+          return;
+     }
+
+     bucket = bucketdir_insert_concurrent(hashing->dir, key, &hashing->next_bucket);
+     hashing->indices[id] = bucket;
+     if (bucket == LSH_NO_INDEX){
+          __atomic_store_n(&hashing->status, LSH_NO_MEMORY, __ATOMIC_RELAXED);
+          return;
+     }
+
+     __atomic_fetch_add(&hashing->counts[bucket], 1, __ATOMIC_RELAXED);
+     first = __atomic_load_n(&hashing->first[bucket], __ATOMIC_RELAXED);
+     while (id < first && !__atomic_compare_exchange_n(&hashing->first[bucket], &first, id, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/************************ Function prototypes ************************/
+uint parallel_number_of_threads(uint);
+void parallel_for(uint, uint, ParallelWork, void *);
+void parallel_buckets_init(ParallelBuckets *);
+void parallel_buckets_destroy(ParallelBuckets *);
+int parallel_hash_ids(BucketDir *, uint, ParallelWork, void *, uint, uint *, ParallelBuckets *);
+int parallel_layout_ids(ParallelBuckets *, uint *, uint, Item *, uint);
+#endif
@@ -22,10 +22,54 @@
 
 #include "l1lsh.h"
 #include "lplsh.h"
+#include "bucketdir.h"
+
+typedef int (*SampledSink)(List *, void *);
+typedef double (*SampledScore)(List *, void *);
+
+typedef struct SampledTopKEntry {
+     List list;
+     ullong hash;
+     ullong order;
+     double score;
+     uint multiplicity;
+     uint position;
+     uint next;
+} SampledTopKEntry;
+
+typedef struct SampledTopK {
+     uint k;
+     uint size;
+     SampledScore score;
+     void *data;
+     ullong sequence;
+     uint *heap;
+     SampledTopKEntry *entries;
+     BucketDir dir;
+} SampledTopK;
 
 void sampledlsh_l1_get_coitems(ListDB *, HashTableL1 *);
-ListDB sampledlsh_l1mine(ListDB *, uint, uint, uint, uint);
+ListDB sampledlsh_l1mine(ListDB *, uint, uint, uint, uint, uint);
 void sampledlsh_lp_get_coitems(ListDB *, HashTableLP *);
-ListDB sampledlsh_lpmine(VectorDB *, uint, uint, double, uint, double (*ps_dist)(void));
+ListDB sampledlsh_lpmine(VectorDB *, uint, uint, double, uint, double (*ps_dist)(void), uint);
+ListDB sampledlsh_l1mine_unique(ListDB *, uint, uint, uint, uint, List *, uint);
+ListDB sampledlsh_lpmine_unique(VectorDB *, uint, uint, double, uint, double (*ps_dist)(void), List *,
+                                uint);
+int sampledlsh_write_coitems(List *, void *);
+int sampledlsh_l1mine_stream(ListDB *, uint, uint, uint, uint, SampledSink, void *, uint);
+int sampledlsh_lpmine_stream(VectorDB *, uint, uint, double, uint, double (*ps_dist)(void),
+                             SampledSink, void *, uint);
+int sampledlsh_l1mine_to_file(char *, ListDB *, uint, uint, uint, uint, uint);
+int sampledlsh_lpmine_to_file(char *, VectorDB *, uint, uint, double, uint, double (*ps_dist)(void),
+                              uint);
+double sampledlsh_score_size(List *, void *);
+SampledTopK sampledlsh_topk_create(uint, SampledScore, void *);
+void sampledlsh_topk_destroy(SampledTopK *);
+int sampledlsh_topk_insert(List *, void *);
+int sampledlsh_topk_collect(SampledTopK *, ListDB *, List *);
+ListDB sampledlsh_l1mine_topk(ListDB *, uint, uint, uint, uint, uint, SampledScore, void *, List *,
+                              uint);
+ListDB sampledlsh_lpmine_topk(VectorDB *, uint, uint, double, uint, double (*ps_dist)(void), uint,
+                              SampledScore, void *, List *, uint);
 
 #endif
@@ -31,6 +31,11 @@
 #define LARGEST_INT64 18446744073709551615ULL
 #define LARGEST_PRIME64 18446744073709551557ULL
 
+#define LSH_OK 0 //Operation succeeded
+#define LSH_NO_MEMORY -1 //Memory could not be allocated
+#define LSH_INVALID -2 //Invalid argument or state of the hash table
+#define LSH_NO_INDEX 4294967295U //Invalid bucket index (returned on failure)
+
 typedef unsigned char uchar;
 typedef unsigned short ushort;
 typedef unsigned int uint;
@@ -0,0 +1,99 @@
+/**
+ * @file univhash.h
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Universal hashing of tuples of hash values modulo the Mersenne
+ *        prime 2^61 - 1. Reductions only need shifts, masks and adds, and
+ *        table indices are obtained by multiply-shift (fastrange), so no
+ *        integer division is performed.
+ */
+#ifndef UNIVHASH_H
+#define UNIVHASH_H
+
+#include "types.h"
+
+#define UNIVHASH_PRIME 2305843009213693951ULL //Mersenne prime 2^61 - 1
+
+/**
+ * @brief Reduces a 64-bit integer modulo 2^61 - 1
+ */
+static inline ullong univhash_mod(ullong x)
+{
+     x = (x & UNIVHASH_PRIME) + (x >> 61);
+     return x >= UNIVHASH_PRIME ? x - UNIVHASH_PRIME : x;
+}
+
+/**
+ * @brief Draws a coefficient in [1, 2^61 - 2] from a 64-bit random integer
+ */
+static inline ullong univhash_coefficient(ullong random)
+{
+     ullong coefficient = univhash_mod(random);
+     return coefficient == 0 ? 1 : coefficient;
+}
+
+/**
+ * @brief Adds coefficient * value to an accumulator modulo 2^61 - 1
+ */
+static inline ullong univhash_add(ullong acc, ullong coefficient, ullong value)
+{
+     __uint128_t product = (__uint128_t) coefficient * univhash_mod(value);
+     return univhash_mod(acc + ((ullong) product & UNIVHASH_PRIME) + (ullong) (product >> 61));
+}
+
+/**
+ * @brief Universal hash of a tuple: sum of coefficients[i] * values[i]
+ *        modulo 2^61 - 1
+ */
+static inline ullong univhash_tuple(const ullong *values, const ullong *coefficients, uint size)
+{
+     uint i;
+     ullong acc = 0;
+
+     for (i = 0; i < size; i++)
+          acc = univhash_add(acc, coefficients[i], values[i]);
+
+     return acc;
+}
+
+/**
+ * @brief Universal hashes of consecutive bands of a signature. Band j is
+ *        made of values [j * band_size, (j + 1) * band_size) and is hashed
+ *        with the coefficients in the same positions. The bands are
+ *        accumulated side by side so their chains are independent.
+ */
+static inline void univhash_bands(const ullong *values, const ullong *coefficients, uint band_size,
+                                  uint number_of_bands, ullong *hashes)
+{
+     uint i, j;
+
+     for (j = 0; j < number_of_bands; j++)
+          hashes[j] = 0;
+
+     for (i = 0; i < band_size; i++)
+          for (j = 0; j < number_of_bands; j++)
+               hashes[j] = univhash_add(hashes[j], coefficients[(size_t) j * band_size + i],
+                                        values[(size_t) j * band_size + i]);
+}
+
+/**
+ * @brief Maps a hash in [0, 2^61 - 1) to [0, size) by multiply-shift
+ */
+static inline uint univhash_range(ullong hash, uint size)
+{
+     return (uint) (((__uint128_t) hash * size) >> 61);
+}
+#endif
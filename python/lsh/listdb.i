@@ -23,6 +23,7 @@ extern void listdb_print_multi(ListDB *, List *);
 extern void listdb_print_range(ListDB *, uint, uint);
 extern void listdb_delete_smallest(ListDB *, uint);
 extern void listdb_delete_largest(ListDB *, uint);
+extern ListDB listdb_invert(ListDB *, uint);
 extern ListDB listdb_load_from_file(char *);
 extern void listdb_save_to_file(char *, ListDB *);
 extern void listdb_apply_to_all(ListDB *, void (*)(List *));
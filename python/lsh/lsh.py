@@ -130,22 +130,73 @@ class L1LSH:
         """
         la.listdb_print(self.ldb)
 
-    def mine(self,tuple_size,num_tuples,max_value,table_size=2**19):
-        """
-        Mines co-occurring items from a database of lists using Sampled LSH
-        """
-
-        ldb=la.sampledlsh_l1mine(self.ldb,tuple_size,num_tuples,max_value,table_size)
+    def mine(self,tuple_size,num_tuples,max_value,table_size=2**19,threads=0,unique=False,
+             topk=0,rank='size'):
+        """
+        Mines co-occurring items from a database of lists using Sampled LSH.
+        Tables are mined by threads threads (0 for all processors).
+        If unique is True, lists found by several tables are kept once and the
+        number of tables that found each list is stored in the multiplicity List.
+        If topk is positive, only the topk best distinct lists are kept, ranked by
+        rank: 'size' or 'multiplicity'.
+        """
+        if topk > 0:
+            multiplicity=la.List()
+            score = la.sampledlsh_score_size if rank == 'size' else None
+            ldb=la.sampledlsh_l1mine_topk(self.ldb,tuple_size,num_tuples,max_value,table_size,
+                                          topk,score,None,multiplicity,threads)
+            mined=L1LSH(ldb=ldb)
+            mined.multiplicity=multiplicity
+            return mined
+
+        if unique:
+            multiplicity=la.List()
+            ldb=la.sampledlsh_l1mine_unique(self.ldb,tuple_size,num_tuples,max_value,table_size,
+                                            multiplicity,threads)
+            mined=L1LSH(ldb=ldb)
+            mined.multiplicity=multiplicity
+            return mined
+
+        ldb=la.sampledlsh_l1mine(self.ldb,tuple_size,num_tuples,max_value,table_size,threads)
             
-        return LSH(ldb=ldb)
+        return L1LSH(ldb=ldb)
 
-    def cluster_mhlink(self, num_tuples=255, tuple_size=3, table_size=2**20, thres=0.7,
-                       min_cluster_size=3):
+    def mine_to_file(self,filename,tuple_size,num_tuples,max_value,table_size=2**19,threads=0):
         """
-        Clusters a database of mined lists using agglomerative clustering based on LSH
+        Mines co-occurring items from a database of lists using Sampled LSH and writes
+        them to filename as each table is processed, so mined lists are not kept in memory.
+        Returns True on success.
         """
-        models=la.mhlink_cluster(self.ldb, tuple_size, num_tuples, table_size,
-                                 la.list_overlap, thres, min_cluster_size)
+        return la.sampledlsh_l1mine_to_file(filename,self.ldb,tuple_size,num_tuples,max_value,
+                                            table_size,threads) == 0
+
+    def cluster_mhlink(self, num_tuples=255, tuple_size=3, table_size=2**20, thres=0.7,
+                       min_cluster_size=3, weighted=False, cache=None, seed=0,
+                       max_bucket_size=0, bucket_policy='sample', threads=1):
+        """
+        Clusters a database of mined lists using agglomerative clustering based on LSH.
+        If weighted is True, item frequencies are hashed with consistent weighted sampling.
+        If cache is a filename, the MinHash signatures are stored in (or read from) it.
+        Buckets with more than max_bucket_size lists (0 for no limit) are handled with
+        bucket_policy: 'keep' (only reported), 'sample', 'split' or 'stop'.
+        Lists are stored in the hash tables by threads threads (0 for all processors).
+        """
+        policies = {'keep': la.MH_BUCKET_KEEP, 'sample': la.MH_BUCKET_SAMPLE,
+                    'split': la.MH_BUCKET_SPLIT, 'stop': la.MH_BUCKET_STOP}
+        options = la.MHLinkOptions()
+        options.max_bucket_size = max_bucket_size
+        options.bucket_policy = policies[bucket_policy]
+        options.number_of_threads = threads
+        scheme = la.MH_WEIGHTED if weighted else la.MH_HASHED
+
+        if cache:
+            models=la.mhlink_cluster_cached(self.ldb, tuple_size, num_tuples, table_size,
+                                            scheme, seed, cache, la.list_overlap, thres,
+                                            min_cluster_size, options)
+        else:
+            models=la.mhlink_cluster_scheme(self.ldb, tuple_size, num_tuples, table_size,
+                                            scheme, None, la.list_overlap, thres,
+                                            min_cluster_size, options)
 
         la.listdb_apply_to_all(models, la.list_sort_by_frequency_back)
                 
@@ -166,6 +217,13 @@ class L1LSH:
         
         return ldb
 
+    def invert(self,threads=0):
+        """
+        Returns the inverted file of the ListDB structure, computed by threads
+        threads (0 for all processors)
+        """
+        return L1LSH(ldb=la.listdb_invert(self.ldb,threads))
+
     def cutoff(self,min=5,max=None):
         """
         Removes the largest and smallest lists in the ListDB
@@ -250,17 +308,54 @@ class LPLSH:
         """
         la.vectordb_print(self.vdb)
 
-    def mine(self,tuple_size=8,num_tuples=100,norm='l1',width=3.0,table_size=2**19):
-        """
-        Mines co-occurring items from a database of lists using Sampled LSH
-        """
+    def mine(self,tuple_size=8,num_tuples=100,norm='l1',width=3.0,table_size=2**19,threads=0,
+             unique=False,topk=0,rank='size'):
+        """
+        Mines co-occurring items from a database of lists using Sampled LSH.
+        Tables are mined by threads threads (0 for all processors).
+        If unique is True, lists found by several tables are kept once and the
+        number of tables that found each list is stored in the multiplicity List.
+        If topk is positive, only the topk best distinct lists are kept, ranked by
+        rank: 'size' or 'multiplicity'.
+        """
+        ps_dist = la.lplsh_rng_cauchy if norm == 'l1' else la.lplsh_rng_gaussian
+        if topk > 0:
+            multiplicity=la.List()
+            score = la.sampledlsh_score_size if rank == 'size' else None
+            ldb=la.sampledlsh_lpmine_topk(self.vdb,tuple_size,num_tuples,width,table_size,ps_dist,
+                                          topk,score,None,multiplicity,threads)
+            mined=L1LSH(ldb=ldb)
+            mined.multiplicity=multiplicity
+            return mined
+
+        if unique:
+            multiplicity=la.List()
+            ldb=la.sampledlsh_lpmine_unique(self.vdb,tuple_size,num_tuples,width,table_size,ps_dist,
+                                            multiplicity,threads)
+            mined=L1LSH(ldb=ldb)
+            mined.multiplicity=multiplicity
+            return mined
+
         if norm == 'l1':
-            ldb=la.sampledlsh_lpmine(self.vdb,tuple_size,num_tuples,width,table_size, la.lplsh_rng_cauchy)
+            ldb=la.sampledlsh_lpmine(self.vdb,tuple_size,num_tuples,width,table_size, la.lplsh_rng_cauchy,
+                                     threads)
         else:
-            ldb=la.sampledlsh_lpmine(self.vdb,tuple_size,num_tuples,width,table_size, la.lplsh_rng_gaussian)
+            ldb=la.sampledlsh_lpmine(self.vdb,tuple_size,num_tuples,width,table_size, la.lplsh_rng_gaussian,
+                                     threads)
 
         return L1LSH(ldb=ldb)
 
+    def mine_to_file(self,filename,tuple_size=8,num_tuples=100,norm='l1',width=3.0,table_size=2**19,
+                     threads=0):
+        """
+        Mines co-occurring items from a database of vectors using Sampled LSH and writes
+        them to filename as each table is processed, so mined lists are not kept in memory.
+        Returns True on success.
+        """
+        ps_dist = la.lplsh_rng_cauchy if norm == 'l1' else la.lplsh_rng_gaussian
+        return la.sampledlsh_lpmine_to_file(filename,self.vdb,tuple_size,num_tuples,width,
+                                            table_size,ps_dist,threads) == 0
+
     def size(self):
         """
         Returns the size of the ListDB structure
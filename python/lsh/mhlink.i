@@ -4,7 +4,17 @@
 %{
 #include "mhlink.h"
 %}
- 
+
+typedef struct MHLinkOptions {
+     uint max_bucket_size;
+     uint bucket_policy;
+     uint number_of_threads;
+} MHLinkOptions;
+
 extern ListDB mhlink_cluster(ListDB *, uint, uint, uint, double (*)(List *, List *), double, uint);
+extern ListDB mhlink_cluster_scheme(ListDB *, uint, uint, uint, uint, double *,
+                                    double (*)(List *, List *), double, uint, MHLinkOptions *);
+extern ListDB mhlink_cluster_cached(ListDB *, uint, uint, uint, uint, unsigned long long, char *,
+                                    double (*)(List *, List *), double, uint, MHLinkOptions *);
 extern ListDB mhlink_make_model(ListDB *, ListDB *);
 
@@ -7,6 +7,16 @@
 
 %}
 
+#define MH_PERMUTATIONS 0
+#define MH_HASHED 1
+#define MH_OPH 2
+#define MH_WEIGHTED 3
+
+#define MH_BUCKET_KEEP 0
+#define MH_BUCKET_SAMPLE 1
+#define MH_BUCKET_SPLIT 2
+#define MH_BUCKET_STOP 3
+
 extern void mh_rng_init(unsigned long long);
 extern uint * mh_get_cumulative_frequency(ListDB *, ListDB *);
 extern ListDB mh_expand_listdb(ListDB *, uint *);
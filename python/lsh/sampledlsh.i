@@ -9,5 +9,20 @@
 #define DEF_TABLE_SIZE 524288
 %}
 
-extern ListDB sampledlsh_l1mine(ListDB *, uint, uint, uint, uint);
-extern ListDB sampledlsh_lpmine(VectorDB *, uint, uint, double, uint, double (*)(void));
+%pythoncallback;
+extern double sampledlsh_score_size(List *, void *);
+%nopythoncallback;
+
+%ignore sampledlsh_score_size;
+
+extern ListDB sampledlsh_l1mine(ListDB *, uint, uint, uint, uint, uint);
+extern ListDB sampledlsh_lpmine(VectorDB *, uint, uint, double, uint, double (*)(void), uint);
+extern ListDB sampledlsh_l1mine_unique(ListDB *, uint, uint, uint, uint, List *, uint);
+extern ListDB sampledlsh_lpmine_unique(VectorDB *, uint, uint, double, uint, double (*)(void), List *,
+                                       uint);
+extern int sampledlsh_l1mine_to_file(char *, ListDB *, uint, uint, uint, uint, uint);
+extern int sampledlsh_lpmine_to_file(char *, VectorDB *, uint, uint, double, uint, double (*)(void), uint);
+extern ListDB sampledlsh_l1mine_topk(ListDB *, uint, uint, uint, uint, uint, double (*)(List *, void *),
+                                     void *, List *, uint);
+extern ListDB sampledlsh_lpmine_topk(VectorDB *, uint, uint, double, uint, double (*)(void), uint,
+                                     double (*)(List *, void *), void *, List *, uint);
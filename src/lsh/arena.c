@@ -0,0 +1,171 @@
+/**
+ * @file arena.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Arenas: memory is handed out from large blocks by bumping an
+ *        offset and is only released all at once. Rewinding an arena makes
+ *        its blocks available again without returning them to the system,
+ *        so structures that are rebuilt many times (like the hash tables of a clustering) do not call free and
+ *        realloc for each of their lists.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 8
+
+/**
+ * @brief Initializes an arena structure to zero
+ *
+ * @param arena Arena
+ */
+void arena_init(Arena *arena)
+{
+     arena->first = NULL;
+     arena->current = NULL;
+     arena->block_size = ARENA_MIN_BLOCK_SIZE;
+}
+
+/**
+ * @brief Allocates memory from an arena. The blocks after the current one
+ *        (left by a rewind) are reused when the request fits, otherwise a
+ *        new block is inserted after the current one. Block sizes double up
+ *        to ARENA_MAX_BLOCK_SIZE, and larger requests get their own block.
+ *
+ * @param arena Arena
+ * @param bytes Number of bytes
+ *
+ * @return Pointer to memory aligned to 8 bytes, NULL if it could not be allocated
+ */
+void *arena_alloc(Arena *arena, size_t bytes)
+{
+     ArenaBlock *block;
+     
+     bytes = (bytes + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+
+     if (arena->current != NULL && arena->current->size - arena->current->used < bytes){
+          // moves to the next block left by a rewind if the request fits
+          block = arena->current->next;
+          if (block != NULL && block->size >= bytes){
+               block->used = 0;
+               arena->current = block;
+          }
+     }
+
+     if (arena->current == NULL || arena->current->size - arena->current->used < bytes){
+          size_t size = arena->block_size > bytes ? arena->block_size : bytes;
+          block = (ArenaBlock *) malloc(sizeof(ArenaBlock) + size);
+          if (block == NULL)
+               return NULL;
+          block->size = size;
+          block->used = 0;
+          if (arena->current == NULL){
+               block->next = arena->first;
+               arena->first = block;
+          } else {
+               block->next = arena->current->next;
+               arena->current->next = block;
+          }
+          arena->current = block;
+          if (arena->block_size < ARENA_MAX_BLOCK_SIZE)
+               arena->block_size *= 2;
+     }
+
+     void *ptr = (char *) (arena->current + 1) + arena->current->used;
+     arena->current->used += bytes;
+
+     return ptr;
+}
+
+/**
+ * @brief Releases all the memory allocated from an arena at once keeping
+ *        its blocks
+ *
+ * @param arena Arena
+ */
+void arena_rewind(Arena *arena)
+{
+     arena->current = arena->first;
+     if (arena->current != NULL)
+          arena->current->used = 0;
+}
+
+/**
+ * @brief Destroys an arena returning its blocks to the system
+ *
+ * @param arena Arena
+ */
+void arena_destroy(Arena *arena)
+{
+     ArenaBlock *block = arena->first;
+
+     while (block != NULL){
+          ArenaBlock *next = block->next;
+          free(block);
+          block = next;
+     }
+     arena_init(arena);
+}
+
+/**
+ * @brief Number of items allocated by arena_push for a list of a given
+ *        size, i.e. the smallest power of two not smaller than the size
+ *
+ * @param size Number of items of the list
+ *
+ * @return Capacity of the list
+ */
+size_t arena_capacity(uint size)
+{
+     size_t capacity = 1;
+
+     if (size == 0)
+          return 0;
+     while (capacity < size)
+          capacity <<= 1;
+
+     return capacity;
+}
+
+/**
+ * @brief Adds an item to the end of a list whose items are allocated in an
+ *        arena. Capacities are powers of two, so a list only moves when its
+ *        size is zero or a power of two (the old items are released when the
+ *        arena is rewound, or when an index is compacted).
+ *
+ * @param arena Arena
+ * @param list List where the item will be added
+ * @param item Item to be added
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int arena_push(Arena *arena, List *list, Item item)
+{
+     if ((list->size & (list->size - 1)) == 0){ // list is full
+          uint capacity = list->size ? 2 * list->size : 1;
+          Item *data = (Item *) arena_alloc(arena, (size_t) capacity * sizeof(Item));
+          if (data == NULL)
+               return LSH_NO_MEMORY;
+          if (list->size > 0)
+               memcpy(data, list->data, list->size * sizeof(Item));
+          list->data = data;
+     }
+
+     list->data[list->size++] = item;
+
+     return LSH_OK;
+}
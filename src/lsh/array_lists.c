@@ -610,20 +610,20 @@ void list_delete_more_frequent(List *list, uint max_freq)
  */
 void list_unique(List *list)
 {
-     uint i;
+     uint i, size = 0;
 
-     if (list->size > 0) {
-          for (i = 0; i < list->size - 1; i++) {
-               if (list->data[i].item == list->data[i + 1].item) {
-                    int k = 1;
-                    while(i + k < list->size &&
-                          list->data[i].item == list->data[i + k].item) {
-                         list->data[i].freq += list->data[i + k].freq;
-                         k++;
-                    }
-                    list_delete_range(list, i + 1, i + k - 1);
-               }
-          }
+     // compacts consecutive runs of the same item in a single pass
+     for (i = 0; i < list->size; i++) {
+          if (size > 0 && list->data[size - 1].item == list->data[i].item)
+               list->data[size - 1].freq += list->data[i].freq;
+          else
+               list->data[size++] = list->data[i];
+     }
+
+     if (size < list->size) {
+          if (size > 0)
+               list->data = realloc(list->data, size * sizeof(Item));
+          list->size = size;
      }
 }
 
@@ -0,0 +1,392 @@
+/**
+ * @file bucketdir.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Bucket directories: Swiss-table style hash maps from the full
+ *        2nd-level hash value of a tuple to the number of its bucket. Each
+ *        slot has a control byte holding 7 bits of the hash of its key (or
+ *        BUCKETDIR_EMPTY), and slots are probed in groups of
+ *        BUCKETDIR_GROUP_SIZE control bytes compared at once with SSE2 (or
+ *        with a scalar loop on other architectures). Full keys are only
+ *        compared for the slots whose control byte matches. The number of
+ *        slots is a power of two and is doubled whenever the load factor
+ *        exceeds BUCKETDIR_MAX_LOAD, so tables never fill up. Bucket numbers
+ *        do not change when the directory grows.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bucketdir.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define BUCKETDIR_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+/**
+ * @brief Initializes a bucket directory structure to zero
+ *
+ * @param dir Bucket directory
+ */
+void bucketdir_init(BucketDir *dir)
+{
+     dir->capacity = 0;
+     dir->size = 0;
+     dir->ctrl = NULL;
+     dir->slots = NULL;
+}
+
+/**
+ * @brief Creates an empty bucket directory with at least a given number of
+ *        slots (rounded up to a power of two). If memory cannot be allocated
+ *        the directory has no slots.
+ *
+ * @param capacity Requested number of slots
+ *
+ * @return Bucket directory
+ */
+BucketDir bucketdir_create(uint capacity)
+{
+     BucketDir dir;
+     uint slots = BUCKETDIR_MIN_CAPACITY;
+
+     while (slots < capacity && slots < 0x80000000U)
+          slots <<= 1;
+
+     bucketdir_init(&dir);
+     dir.ctrl = (uchar *) malloc(slots * sizeof(uchar));
+     dir.slots = (BucketDirSlot *) malloc(slots * sizeof(BucketDirSlot));
+     if (dir.ctrl == NULL || dir.slots == NULL){
+          free(dir.ctrl);
+          free(dir.slots);
+          bucketdir_init(&dir);
+          return dir;
+     }
+
+     dir.capacity = slots;
+     bucketdir_clear(&dir);
+
+     return dir;
+}
+
+/**
+ * @brief Removes all the keys of a bucket directory keeping its slots
+ *
+ * @param dir Bucket directory
+ */
+void bucketdir_clear(BucketDir *dir)
+{
+     if (dir->ctrl != NULL)
+          memset(dir->ctrl, BUCKETDIR_EMPTY, dir->capacity * sizeof(uchar));
+     dir->size = 0;
+}
+
+/**
+ * @brief Destroys a bucket directory
+ *
+ * @param dir Bucket directory
+ */
+void bucketdir_destroy(BucketDir *dir)
+{
+     free(dir->ctrl);
+     free(dir->slots);
+     bucketdir_init(dir);
+}
+
+/**
+ * @brief Mixes a key by multiplying it by the golden ratio. The upper
+ *        7 bits are stored in the control byte of its slot and lower
+ *        bits select its home group.
+ *
+ * @param key 2nd-level hash value
+ *
+ * @return Mixed key
+ */
+static inline ullong bucketdir_hash(ullong key)
+{
+     return key * BUCKETDIR_GOLDEN_GAMMA;
+}
+
+/**
+ * @brief Control byte of a key
+ */
+static inline uchar bucketdir_h2(ullong hash)
+{
+     return (uchar) (hash >> 57);
+}
+
+/**
+ * @brief Home group of a key
+ */
+static inline uint bucketdir_home(BucketDir *dir, ullong hash)
+{
+     return (uint) (hash >> 24) & (dir->capacity / BUCKETDIR_GROUP_SIZE - 1);
+}
+
+/**
+ * @brief Compares the control bytes of a group against a byte
+ *
+ * @param ctrl First control byte of the group
+ * @param byte Byte to compare
+ *
+ * @return Bit mask with bit i set if control byte i is equal to byte
+ */
+static inline uint bucketdir_match(const uchar *ctrl, uchar byte)
+{
+#ifdef __SSE2__
+     __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+     return (uint) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) byte)));
+#else
+     uint i, mask = 0;
+     for (i = 0; i < BUCKETDIR_GROUP_SIZE; i++)
+          if (ctrl[i] == byte)
+               mask |= 1U << i;
+     return mask;
+#endif
+}
+
+/**
+ * @brief Probes a bucket directory for a key. Groups are visited by
+ *        triangular probing, which covers all the groups since their
+ *        number is a power of two. Keys are never deleted, so the search
+ *        stops at the first group with an empty slot.
+ *
+ * @param dir Bucket directory (with at least one slot)
+ * @param key 2nd-level hash value
+ * @param slot Slot of the key, or first empty slot if the key was not found
+ *
+ * @return 1 if the key was found, 0 otherwise
+ */
+static int bucketdir_probe(BucketDir *dir, ullong key, uint *slot)
+{
+     ullong hash = bucketdir_hash(key);
+     uchar h2 = bucketdir_h2(hash);
+     uint group_mask = dir->capacity / BUCKETDIR_GROUP_SIZE - 1;
+     uint group = bucketdir_home(dir, hash);
+     uint step = 0;
+
+     for (;;){
+          uint base = group * BUCKETDIR_GROUP_SIZE;
+          uint candidates = bucketdir_match(&dir->ctrl[base], h2);
+          uint empty;
+
+          while (candidates){ // compares full keys of matching control bytes
+               uint i = base + (uint) __builtin_ctz(candidates);
+               if (dir->slots[i].key == key){
+                    *slot = i;
+                    return 1;
+               }
+               candidates &= candidates - 1;
+          }
+
+          empty = bucketdir_match(&dir->ctrl[base], BUCKETDIR_EMPTY);
+          if (empty){
+               *slot = base + (uint) __builtin_ctz(empty);
+               return 0;
+          }
+
+          step++;
+          group = (group + step) & group_mask;
+     }
+}
+
+/**
+ * @brief Finds the bucket of a key
+ *
+ * @param dir Bucket directory
+ * @param key 2nd-level hash value
+ *
+ * @return Bucket number, LSH_NO_INDEX if the key is not in the directory
+ */
+uint bucketdir_find(BucketDir *dir, ullong key)
+{
+     uint slot;
+
+     if (dir->capacity == 0 || !bucketdir_probe(dir, key, &slot))
+          return LSH_NO_INDEX;
+
+     return dir->slots[slot].bucket;
+}
+
+/**
+ * @brief Doubles the number of slots of a bucket directory and reinserts
+ *        its keys
+ *
+ * @param dir Bucket directory
+ *
+ * @return LSH_OK or LSH_NO_MEMORY (the directory is left unchanged)
+ */
+int bucketdir_grow(BucketDir *dir)
+{
+     uint i, slot;
+     BucketDir new_dir = bucketdir_create(dir->capacity < BUCKETDIR_MIN_CAPACITY ?
+                                          BUCKETDIR_MIN_CAPACITY : dir->capacity * 2);
+
+     if (new_dir.capacity == 0 || new_dir.capacity <= dir->capacity){
+          bucketdir_destroy(&new_dir);
+          return LSH_NO_MEMORY;
+     }
+
+     for (i = 0; i < dir->capacity; i++){
+          if (dir->ctrl[i] != BUCKETDIR_EMPTY){
+               bucketdir_probe(&new_dir, dir->slots[i].key, &slot);
+               new_dir.ctrl[slot] = dir->ctrl[i];
+               new_dir.slots[slot] = dir->slots[i];
+          }
+     }
+     new_dir.size = dir->size;
+
+     bucketdir_destroy(dir);
+     *dir = new_dir;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Finds the bucket of a key, inserting the key with a new bucket
+ *        number if it is not in the directory. The directory grows
+ *        before its load factor exceeds BUCKETDIR_MAX_LOAD.
+ *
+ * @param dir Bucket directory
+ * @param key 2nd-level hash value
+ * @param new_bucket Bucket number assigned if the key is new
+ * @param bucket Bucket number of the key
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int bucketdir_insert(BucketDir *dir, ullong key, uint new_bucket, uint *bucket)
+{
+     uint slot;
+
+     if (dir->capacity != 0 && bucketdir_probe(dir, key, &slot)){
+          *bucket = dir->slots[slot].bucket;
+          return LSH_OK;
+     }
+
+     if ((double) (dir->size + 1) > BUCKETDIR_MAX_LOAD * dir->capacity){
+          if (bucketdir_grow(dir) != LSH_OK)
+               return LSH_NO_MEMORY;
+          bucketdir_probe(dir, key, &slot);
+     }
+
+     dir->ctrl[slot] = bucketdir_h2(bucketdir_hash(key));
+     dir->slots[slot].key = key;
+     dir->slots[slot].bucket = new_bucket;
+     dir->size++;
+     *bucket = new_bucket;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Sets the bucket number of a key, inserting the key if it is not
+ *        in the directory
+ *
+ * @param dir Bucket directory
+ * @param key 2nd-level hash value
+ * @param bucket Bucket number of the key
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int bucketdir_assign(BucketDir *dir, ullong key, uint bucket)
+{
+     uint slot;
+
+     if (dir->capacity != 0 && bucketdir_probe(dir, key, &slot)){
+          dir->slots[slot].bucket = bucket;
+          return LSH_OK;
+     }
+
+     return bucketdir_insert(dir, key, bucket, &slot);
+}
+
+/**
+ * @brief Grows a bucket directory until a given number of keys fits
+ *        without exceeding BUCKETDIR_MAX_LOAD, so that they can be inserted
+ *        concurrently (see bucketdir_insert_concurrent)
+ *
+ * @param dir Bucket directory
+ * @param size Number of keys
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int bucketdir_reserve(BucketDir *dir, uint size)
+{
+     while (dir->capacity == 0 || (double) size > BUCKETDIR_MAX_LOAD * dir->capacity)
+          if (bucketdir_grow(dir) != LSH_OK)
+               return LSH_NO_MEMORY;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Finds the bucket of a key, inserting the key with a new bucket
+ *        number if it is not in the directory. Several threads can call
+ *        this function on the same directory: an empty slot is claimed by
+ *        a CAS of its control byte to BUCKETDIR_BUSY, the key and bucket
+ *        are written and the control byte of the key is then published.
+ *        Threads probing a busy slot wait until it is published, so a key
+ *        is inserted only once. Slots are visited in the same order as
+ *        bucketdir_find. The directory does not grow, so enough slots must
+ *        have been reserved with bucketdir_reserve, and no other function
+ *        may access the directory until all threads are done.
+ *
+ * @param dir Bucket directory
+ * @param key 2nd-level hash value
+ * @param next_bucket Counter from which new bucket numbers are taken
+ *
+ * @return Bucket number, LSH_NO_INDEX if the directory is full
+ */
+uint bucketdir_insert_concurrent(BucketDir *dir, ullong key, uint *next_bucket)
+{
+     ullong hash = bucketdir_hash(key);
+     uchar h2 = bucketdir_h2(hash);
+     uint group_mask = dir->capacity / BUCKETDIR_GROUP_SIZE - 1;
+     uint group = bucketdir_home(dir, hash);
+     uint step, i;
+
+     if (dir->capacity == 0)
+          return LSH_NO_INDEX;
+
+     for (step = 1; step <= group_mask + 1; step++){
+          uint base = group * BUCKETDIR_GROUP_SIZE;
+          for (i = base; i < base + BUCKETDIR_GROUP_SIZE; i++){
+               uchar ctrl = __atomic_load_n(&dir->ctrl[i], __ATOMIC_ACQUIRE);
+
+               if (ctrl == BUCKETDIR_EMPTY){ // tries to claim the slot
+                    if (__atomic_compare_exchange_n(&dir->ctrl[i], &ctrl, BUCKETDIR_BUSY, 0,
+                                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)){
+                         uint bucket = __atomic_fetch_add(next_bucket, 1, __ATOMIC_RELAXED);
+                         dir->slots[i].key = key;
+                         dir->slots[i].bucket = bucket;
+                         __atomic_fetch_add(&dir->size, 1, __ATOMIC_RELAXED);
+                         __atomic_store_n(&dir->ctrl[i], h2, __ATOMIC_RELEASE);
+                         return bucket;
+                    }
+               }
+
+               while (ctrl == BUCKETDIR_BUSY) // another thread is writing its key
+                    ctrl = __atomic_load_n(&dir->ctrl[i], __ATOMIC_ACQUIRE);
+
+               if (ctrl == h2 && dir->slots[i].key == key)
+                    return dir->slots[i].bucket;
+          }
+          group = (group + step) & group_mask;
+     }
+
+     return LSH_NO_INDEX;
+}
@@ -19,9 +19,14 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "mt64.h"
 #include "l1lsh.h"
+#include "univhash.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "parallel.h"
 
 /**
  * @Brief Prints head of a hash table structure
@@ -46,11 +51,7 @@ void l1lsh_print_head(HashTableL1 *hash_table)
 
      printf("a: ");
      for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->a[i]);
-
-     printf("\nb: ");
-     for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->b[i]);
+          printf("%llu ", hash_table->a[i]);
      printf("\n");
 }
 
@@ -84,8 +85,11 @@ void l1lsh_init(HashTableL1 *hash_table)
      hash_table->number_of_samples  = NULL;
      hash_table->buckets = NULL;
      list_init(&hash_table->used_buckets);
+     hash_table->storage = NULL;
+     arena_init(&hash_table->arena);
+     bucketdir_init(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
      hash_table->a = NULL;
-     hash_table->b = NULL;
 }
 
 /**
@@ -100,7 +104,7 @@ void l1lsh_rng_init(unsigned long long seed)
 /**
  * @brief Creates a hash table structure for performing LSH.
  *
- * @param table_size Size of the hash table
+ * @param table_size Initial number of buckets of the hash table (it grows as needed)
  * @param tuple_size Number of hash functions per sketch
  * @param dim Dimensions of the vectors to be hashed
  *
@@ -119,14 +123,15 @@ HashTableL1 l1lsh_create(uint table_size, uint tuple_size, uint dim, uint max_va
      hash_table.number_of_samples = (uint *) calloc(dim, sizeof(uint));    
      hash_table.buckets = (BucketL1 *) calloc(table_size, sizeof(BucketL1));
      list_init(&hash_table.used_buckets);
+     hash_table.storage = NULL;
+     arena_init(&hash_table.arena);
+     hash_table.directory = bucketdir_create(table_size);
+     hash_table.number_of_buckets = 0;
 
      // generates array of random values for universal hashing
-     hash_table.a = (uint *) malloc(tuple_size * sizeof(uint));
-     hash_table.b = (uint *) malloc(tuple_size * sizeof(uint));
-     for (i = 0; i < tuple_size; i++){
-          hash_table.a[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-          hash_table.b[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-     }
+     hash_table.a = (ullong *) malloc(tuple_size * sizeof(ullong));
+     for (i = 0; i < tuple_size; i++)
+          hash_table.a[i] = univhash_coefficient(genrand64_int64());
      
      return hash_table;
 }
@@ -139,55 +144,28 @@ HashTableL1 l1lsh_create(uint table_size, uint tuple_size, uint dim, uint max_va
  */
 void l1lsh_erase_from_vector(List *list, HashTableL1 *hash_table)
 {  
-     uint index = l1lsh_get_index(list, hash_table);
-     list_destroy(&hash_table->buckets[index].items);
-     hash_table->buckets[index].hash_value = 0;
-     
-     Item item = {index, 1};
-     Item *ptr = list_find(&hash_table->used_buckets, item);
-     uint position = (uint) (ptr - hash_table->used_buckets.data);
-     list_delete_position(&hash_table->used_buckets, position);
-}
-
-/**
- * @brief Removes items in a given bucket of the hash table
- *
- * @param index Index of the bucket to be removed
- * @param hash_table Hash table structure
- */
-void l1lsh_erase_from_index(uint index, HashTableL1 *hash_table)
-{  
-     if (index >= 0 && index < hash_table->table_size){
-          // destroy bucket
-          list_destroy(&hash_table->buckets[index].items);
-          hash_table->buckets[index].hash_value = 0;
-
-          // delete bucket index from list of used buckets
-          Item item = {index, 1};
-          Item *ptr = list_find(&hash_table->used_buckets, item);
-          uint position = (uint) (ptr - hash_table->used_buckets.data);
-          list_delete_position(&hash_table->used_buckets, position);
-     } else {
-          printf("Index %u out of range! Table size is %u", index, hash_table->table_size);
-     }
+     uint index = bucketdir_find(&hash_table->directory, l1lsh_compute_hash_value(list, hash_table));
+     if (index != LSH_NO_INDEX)
+          l1lsh_erase_from_index(index, hash_table);
 }
 
 /**
- * @brief Removes the items in all the used buckets of the hash table
+ * @brief Removes the items in all the used buckets of the hash table.
+ *        The IDs are released at once by rewinding the arena, and the
+ *        bucket directory is emptied in time proportional to its capacity.
  *
  * @param hash_table Hash table structure
  */
 void l1lsh_clear_table(HashTableL1 *hash_table)
 {  
-     uint i;
-
-     // empties used buckets of a hash table
-     for (i = 0; i < hash_table->used_buckets.size; i++) {
-          list_destroy(&hash_table->buckets[hash_table->used_buckets.data[i].item].items);
-          hash_table->buckets[hash_table->used_buckets.data[i].item].hash_value = 0;
-     }
-
+     // releases the IDs of all the buckets at once
+     arena_rewind(&hash_table->arena);
+     hash_table->storage = NULL;
      list_destroy(&hash_table->used_buckets);
+
+     // buckets are kept allocated for the next tuples
+     bucketdir_clear(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
 }
 
 /**
@@ -200,8 +178,9 @@ void l1lsh_destroy(HashTableL1 *hash_table)
      free(hash_table->sample_bits);
      free(hash_table->number_of_samples);
      free(hash_table->buckets);
+     arena_destroy(&hash_table->arena);
+     bucketdir_destroy(&hash_table->directory);
      free(hash_table->a);
-     free(hash_table->b);
      list_destroy(&hash_table->used_buckets);
      l1lsh_init(hash_table);
 }
@@ -235,8 +214,22 @@ void l1lsh_generate_sample_bits(uint dim, uint max_value, uint tuple_size, Sampl
 	  
      }
      qsort(sample_bits, tuple_size, sizeof(SampleBits), l1lsh_sample_bit_compare);	
+     free(usedbits);
 } 
 
+/**
+ * @brief Draws new sample bits for a hash table, so that the table can be
+ *        cleared and reused for another tuple.
+ *
+ * @param hash_table Hash table structure
+ */
+void l1lsh_generate_functions(HashTableL1 *hash_table)
+{
+     memset(hash_table->number_of_samples, 0, hash_table->dim * sizeof(uint));
+     l1lsh_generate_sample_bits(hash_table->dim, hash_table->max_value, hash_table->tuple_size,
+                                hash_table->sample_bits, hash_table->number_of_samples);
+}
+
 /**
  * @brief  Compares two samplebits according to their dimension and location
  *     	   (used as comparison function for the qsort function)
@@ -268,26 +261,27 @@ int l1lsh_sample_bit_compare(void const *a, void const *b)
  *        in each dimension
  * @param numbits Number of sample bits (hyperplanes) for one dimension
  * 
- * @return The hash value of *vector (can be stored in multiple integers)
+ * @return 2nd-level hash value of the tuple of hash values of *vector
  */ 
-void l1lsh_compute_hash_value(List *list, HashTableL1 *hash_table,
-                              uint *hash_value, uint *index)
+ullong l1lsh_compute_hash_value(List *list, HashTableL1 *hash_table)
 {
-     int low, mid, high, i, k, l, prev_l;
-     ullong temp_index = 0;
-     ullong temp_hv = 0;
-     uint *hv = (uint *) malloc(hash_table->dim * sizeof(uint));
+     int low, mid, high, i, l, prev_l;
+     uint hv, t = 0;
+     ullong hash_value = 0;
 
      l = 0;
      for(i = 0; i < hash_table->dim && l < hash_table->tuple_size; i++) { 
+          if (hash_table->number_of_samples[i] == 0) // no sample bits in this dimension
+               continue;
+
           low = l;
           prev_l = l;
           l += hash_table->number_of_samples[i];
           high = l - 1;
-          if(hash_table->sample_bits[low].loc > list->data[hash_table->sample_bits[low].dim].freq)
-               hv[i] = 0;
+          if(hash_table->sample_bits[low].loc > list->data[i].freq)
+               hv = 0;
           else if(hash_table->sample_bits[high].loc <= list->data[i].freq)
-               hv[i] = high - low + 1;
+               hv = high - low + 1;
           else{	
                while((low + 1) < high){	
                     mid = (low + high) / 2;
@@ -296,99 +290,247 @@ void l1lsh_compute_hash_value(List *list, HashTableL1 *hash_table,
                     else
                          high = mid;
                }						
-               hv[i] = low + 1 - prev_l; 
+               hv = low + 1 - prev_l; 
           }
 
-          temp_index += ((ullong) hash_table->a[i]) * hv[i];
-          temp_hv += ((ullong) hash_table->b[i]) * hv[i]; 
+          hash_value = univhash_add(hash_value, hash_table->a[t], hv);
+          t++;
      }
 
-     // computes 2nd-level hash value and index (universal hash functions)
-     *hash_value = (temp_hv % LARGEST_PRIME);   
-     *index = (temp_index % LARGEST_PRIME) % hash_table->table_size;
+     return hash_value;
 }
 
+// bucket engine of the hash table (see lshtable.h)
+#define LSH_PREFIX l1lsh
+#define LSH_TABLE HashTableL1
+#define LSH_BUCKET BucketL1
+#define LSH_INDEX HashIndexL1
+#define LSH_OBJECT List
+#define LSH_OBJECT_NAME list
+#define LSH_DB ListDB
+#define LSH_DB_NAME listdb
+#define LSH_DB_OBJECTS lists
+#define LSH_KEY(object, hash_table) l1lsh_compute_hash_value(object, hash_table)
+#include "lshtable.h"
+
 /**
- * @brief Computes 2nd-level hash value of lists using open 
- *        adressing collision resolution and linear probing.
- * @todo Add other probing strategies.
+ * @brief Stores lists in the hash table.
  *
- * @param list List to be hashed
- * @param hash_table Hash table structure
+ * @param listdb Database of lists to be hashed
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets
  *
- * @return - index of the hash table
+ * @return LSH_OK on success, LSH_NO_MEMORY if a list could not be stored
  */ 
-uint l1lsh_get_index(List *list, HashTableL1 *hash_table)
+int l1lsh_store_listdb(ListDB *listdb, HashTableL1 *hash_table, uint *indices)
 {
-     uint checked_buckets, index, hash_value;
+     uint i;
      
-     l1lsh_compute_hash_value(list, hash_table, &hash_value, &index);
-     if (hash_table->buckets[index].items.size != 0){ // examine buckets (open adressing)
-          if (hash_table->buckets[index].hash_value != hash_value){
-               checked_buckets = 1;
-               while (checked_buckets < hash_table->table_size){ // linear probing
-                    index = ((index + 1) & (hash_table->table_size - 1));
-                    if (hash_table->buckets[index].items.size != 0){
-                         if (hash_table->buckets[index].hash_value == hash_value)
-                              break;   
-                    } else {
-                         hash_table->buckets[index].hash_value = hash_value; 
-                         break;
-                    }
-                    checked_buckets++;      
-               }
-               
-               if (checked_buckets == hash_table->table_size){
-                    fprintf(stderr,"Error: The hash table is full!\n ");
-                    exit(EXIT_FAILURE);
-               }
+         
+     // hash all lists in the database
+     for (i = 0; i < listdb->size; i++)
+          if (listdb ->lists[i].size > 0){
+               indices[i] = l1lsh_store_list(&listdb->lists[i], i, hash_table);
+               if (indices[i] == LSH_NO_INDEX)
+                    return LSH_NO_MEMORY;
           }
-     } else {
-          hash_table->buckets[index].hash_value = hash_value; 
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Initializes a multi-table L1LSH index structure to zero
+ *
+ * @param index Hash index structure
+ */
+void l1lsh_index_init(HashIndexL1 *index)
+{
+     index->number_of_tables = 0;
+     index->hash_tables = NULL;
+     locations_init(&index->locations, 0);
+}
+
+/**
+ * @brief Creates an index of number_of_tables hash tables, each with its
+ *        own sample bits
+ *
+ * @param number_of_tables Number of hash tables
+ * @param table_size Initial number of buckets of each hash table
+ * @param tuple_size Number of sample bits per tuple
+ * @param dim Dimensionality of the vectors
+ * @param max_value Largest value in any dimension
+ *
+ * @return Hash index structure
+ */
+HashIndexL1 l1lsh_index_create(uint number_of_tables, uint table_size, uint tuple_size, uint dim,
+                               uint max_value)
+{
+     uint i;
+     HashIndexL1 index;
+
+     l1lsh_index_init(&index);
+     index.number_of_tables = number_of_tables;
+     locations_init(&index.locations, number_of_tables);
+     index.hash_tables = (HashTableL1 *) malloc(number_of_tables * sizeof(HashTableL1));
+     for (i = 0; i < number_of_tables; i++){
+          index.hash_tables[i] = l1lsh_create(table_size, tuple_size, dim, max_value);
+          l1lsh_generate_sample_bits(dim, max_value, tuple_size, index.hash_tables[i].sample_bits,
+                                     index.hash_tables[i].number_of_samples);
      }
-     
+
      return index;
 }
 
 /**
- * @brief Stores lists in the hash table.
+ * @brief Destroys a multi-table L1LSH index structure
  *
- * @param list List to be hashed
+ * @param index Hash index structure
+ */
+void l1lsh_index_destroy(HashIndexL1 *index)
+{
+     uint i;
+
+     for (i = 0; i < index->number_of_tables; i++)
+          l1lsh_destroy(&index->hash_tables[i]);
+     free(index->hash_tables);
+     locations_destroy(&index->locations);
+     l1lsh_index_init(index);
+}
+
+/**
+ * @brief Stores an ID in its bucket of each table and records its
+ *        locations. Tables where the ID stays in the same bucket are not
+ *        modified.
+ *        If the ID cannot be stored in every table, the index is left as it
+ *        was (see index_store_buckets in lshtable.h).
+ *
+ * @param index Hash index structure
+ * @param id ID of the list (reserved in the locations of the index)
+ * @param list List to be stored
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+static int l1lsh_index_store(HashIndexL1 *index, uint id, List *list)
+{
+     uint j;
+     int status = LSH_OK;
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+
+     if (buckets == NULL)
+          return LSH_NO_MEMORY;
+
+     for (j = 0; j < index->number_of_tables && status == LSH_OK; j++){
+          buckets[j] = l1lsh_get_index(list, &index->hash_tables[j]);
+          if (buckets[j] == LSH_NO_INDEX)
+               status = LSH_NO_MEMORY;
+     }
+     if (status == LSH_OK)
+          status = l1lsh_index_store_buckets(index, id, buckets);
+
+     free(buckets);
+
+     return status;
+}
+
+/**
+ * @brief Stores the lists of a database in all the tables of an index.
+ *        Each list is stored in all the tables before moving to the next
+ *        one, so the list is only read while it is in cache.
+ *        Empty lists are not stored.
+ *
+ * @param index Hash index structure
+ * @param listdb Database of lists
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int l1lsh_index_build(HashIndexL1 *index, ListDB *listdb)
+{
+     uint i;
+     int status = LSH_OK;
+
+     if (locations_reserve(&index->locations, listdb->size) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     for (i = 0; i < listdb->size && status == LSH_OK; i++)
+          if (listdb->lists[i].size > 0)
+               status = l1lsh_index_store(index, i, &listdb->lists[i]);
+
+     return status;
+}
+
+/**
+ * @brief Inserts a list in the index or replaces a stored list with
+ *        the same ID. The list is moved only in the tables where its
+ *        bucket changes; its old entries become stale (see
+ *        l1lsh_index_delete). An empty list deletes the ID.
+ *
+ * @param index Hash index structure
  * @param id ID of the list
- * @param hash_table Hash table
- */ 
-uint l1lsh_store_list(List *list, uint id, HashTableL1 *hash_table)
+ * @param list New list
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int l1lsh_index_update(HashIndexL1 *index, uint id, List *list)
 {
-     uint index;
+     int status;
 
-     // get index of the hash table
-     index = l1lsh_get_index(list, hash_table);
-     if (hash_table->buckets[index].items.size == 0){ // mark used bucket
-          Item new_used_bucket = {index, 1};
-          list_push(&hash_table->used_buckets, new_used_bucket);
+     if (list->size == 0){
+          l1lsh_index_delete(index, id);
+          return LSH_OK;
      }
 
-     // store list id in the hash table
-     Item new_item = {id, 1};
-     list_push(&hash_table->buckets[index].items, new_item);
+     if (locations_reserve(&index->locations, id + 1) != LSH_OK)
+          return LSH_NO_MEMORY;
 
-     return index;
+     status = l1lsh_index_store(index, id, list);
+     if (locations_need_compaction(&index->locations))
+          l1lsh_index_compact(index);
+
+     return status;
 }
 
 /**
- * @brief Stores lists in the hash table.
+ * @brief Retrieves the IDs stored in the index that collide with a list in
+ *        at least one table. Buckets are only looked up, so querying does
+ *        not modify the tables.
  *
- * @param listdb Database of lists to be hashed
- * @param hash_table Hash table
- * @param indices Indices of the used buckets
- */ 
-void l1lsh_store_listdb(ListDB *listdb, HashTableL1 *hash_table, uint *indices)
+ * @param index Hash index structure
+ * @param query List to be queried
+ *
+ * @return Sorted list of candidate IDs, whose frequencies are the numbers
+ *         of tables where they collide with the query
+ */
+List l1lsh_index_query(HashIndexL1 *index, List *query)
 {
      uint i;
-     
-         
-     // hash all lists in the database
-     for (i = 0; i < listdb->size; i++)
-          if (listdb ->lists[i].size > 0)
-               indices[i] = l1lsh_store_list(&listdb->lists[i], i, hash_table);
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+     size_t number_of_candidates = 0;
+     List candidates;
+
+     list_init(&candidates);
+     if (buckets == NULL)
+          return candidates;
+
+     // finds the bucket of the query in each table
+     for (i = 0; i < index->number_of_tables; i++){
+          HashTableL1 *hash_table = &index->hash_tables[i];
+          buckets[i] = bucketdir_find(&hash_table->directory, l1lsh_compute_hash_value(query, hash_table));
+          if (buckets[i] != LSH_NO_INDEX)
+               number_of_candidates += hash_table->buckets[buckets[i]].items.size;
+     }
+
+     // merges the buckets and removes repeated IDs
+     candidates.data = (Item *) malloc(number_of_candidates * sizeof(Item));
+     if (candidates.data != NULL){
+          for (i = 0; i < index->number_of_tables; i++)
+               if (buckets[i] != LSH_NO_INDEX)
+                    locations_append(&index->locations, i, buckets[i],
+                                     &index->hash_tables[i].buckets[buckets[i]].items, &candidates);
+          list_sort_by_item(&candidates);
+          list_unique(&candidates);
+     }
+
+     free(buckets);
+
+     return candidates;
 }
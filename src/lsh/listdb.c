@@ -23,6 +23,17 @@
 #include <inttypes.h>
 #include <float.h>
 #include "listdb.h"
+#include "parallel.h"
+
+typedef struct ListDBInversion {
+     ListDB *listdb;
+     ListDB *inverted;
+     uint number_of_threads;
+     uint number_of_items;
+     uint *max_items;
+     ullong *postings;
+     uint *counts;
+} ListDBInversion;
 
 /**
  * @brief Initializes a list database structure to zero
@@ -556,6 +567,171 @@ void listdb_add_lists_destroy(ListDB *listdb, uint position1, uint position2)
      list_destroy(&listdb->lists[position2]);
 }
 
+/**
+ * @brief Finds the largest item and counts the items of the lists of a
+ *        thread of an inversion
+ */
+static void listdb_invert_scan(void *arg, uint start, uint end)
+{
+     uint t, i, j;
+     ListDBInversion *inversion = (ListDBInversion *) arg;
+     ListDB *listdb = inversion->listdb;
+
+     for (t = start; t < end; t++){
+          uint first = (uint) ((ullong) listdb->size * t / inversion->number_of_threads);
+          uint last = (uint) ((ullong) listdb->size * (t + 1) / inversion->number_of_threads);
+          for (i = first; i < last; i++){
+               for (j = 0; j < listdb->lists[i].size; j++)
+                    if (inversion->max_items[t] < listdb->lists[i].data[j].item + 1)
+                         inversion->max_items[t] = listdb->lists[i].data[j].item + 1;
+               inversion->postings[t] += listdb->lists[i].size;
+          }
+     }
+}
+
+/**
+ * @brief Counts the lists of each item among the lists of a thread of an
+ *        inversion
+ */
+static void listdb_invert_count(void *arg, uint start, uint end)
+{
+     uint t, i, j;
+     ListDBInversion *inversion = (ListDBInversion *) arg;
+     ListDB *listdb = inversion->listdb;
+
+     for (t = start; t < end; t++){
+          uint *counts = inversion->counts + (size_t) t * inversion->number_of_items;
+          uint first = (uint) ((ullong) listdb->size * t / inversion->number_of_threads);
+          uint last = (uint) ((ullong) listdb->size * (t + 1) / inversion->number_of_threads);
+          for (i = first; i < last; i++)
+               for (j = 0; j < listdb->lists[i].size; j++)
+                    counts[listdb->lists[i].data[j].item]++;
+     }
+}
+
+/**
+ * @brief Writes the lists of a thread of an inversion in the inverted
+ *        lists of their items, starting at the offsets of the thread
+ */
+static void listdb_invert_scatter(void *arg, uint start, uint end)
+{
+     uint t, i, j;
+     ListDBInversion *inversion = (ListDBInversion *) arg;
+     ListDB *listdb = inversion->listdb;
+     List *inverted = inversion->inverted->lists;
+
+     for (t = start; t < end; t++){
+          uint *offsets = inversion->counts + (size_t) t * inversion->number_of_items;
+          uint first = (uint) ((ullong) listdb->size * t / inversion->number_of_threads);
+          uint last = (uint) ((ullong) listdb->size * (t + 1) / inversion->number_of_threads);
+          for (i = first; i < last; i++){
+               for (j = 0; j < listdb->lists[i].size; j++){
+                    uint item = listdb->lists[i].data[j].item;
+                    Item posting = {i, listdb->lists[i].data[j].freq};
+                    inverted[item].data[offsets[item]++] = posting;
+               }
+          }
+     }
+}
+
+/**
+ * @brief Computes the inverted file of a list database: list i of the
+ *        result holds the positions of the lists that contain item i, in
+ *        increasing order, with the frequency of the item in each list.
+ *        The lists are split in contiguous ranges, one per thread, and
+ *        the inversion is a counting sort in two passes: each thread counts
+ *        the items of its range, the counts give each thread its offsets in
+ *        the inverted lists, and each thread then writes its range at its
+ *        offsets, so no atomic operations are needed and the result does
+ *        not depend on the number of threads. Threads are limited so that
+ *        their counters do not take more memory than the inverted lists.
+ *
+ * @param listdb List database
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Inverted file (empty if memory could not be allocated)
+ */
+ListDB listdb_invert(ListDB *listdb, uint number_of_threads)
+{
+     uint t, i;
+     ullong postings = 0;
+     ListDB inverted;
+     ListDBInversion inversion;
+
+     listdb_init(&inverted);
+     inversion.listdb = listdb;
+     inversion.inverted = &inverted;
+     inversion.number_of_threads = parallel_number_of_threads(number_of_threads);
+     if (inversion.number_of_threads > listdb->size)
+          inversion.number_of_threads = listdb->size > 0 ? listdb->size : 1;
+     inversion.number_of_items = listdb->dim;
+     inversion.max_items = (uint *) calloc(inversion.number_of_threads, sizeof(uint));
+     inversion.postings = (ullong *) calloc(inversion.number_of_threads, sizeof(ullong));
+     inversion.counts = NULL;
+     if (inversion.max_items == NULL || inversion.postings == NULL){
+          fprintf(stderr,"Error: Not enough memory to invert the database\n");
+          free(inversion.max_items);
+          free(inversion.postings);
+          return inverted;
+     }
+
+     // the dimension of the database may be smaller than its largest item
+     parallel_for(inversion.number_of_threads, inversion.number_of_threads, listdb_invert_scan, &inversion);
+     for (t = 0; t < inversion.number_of_threads; t++){
+          if (inversion.number_of_items < inversion.max_items[t])
+               inversion.number_of_items = inversion.max_items[t];
+          postings += inversion.postings[t];
+     }
+     free(inversion.max_items);
+     free(inversion.postings);
+
+     if (inversion.number_of_items > 0 && postings / inversion.number_of_items < inversion.number_of_threads)
+          inversion.number_of_threads = postings / inversion.number_of_items > 0 ?
+               (uint) (postings / inversion.number_of_items) : 1;
+
+     inversion.counts = (uint *) calloc((size_t) inversion.number_of_threads * inversion.number_of_items,
+                                        sizeof(uint));
+     inverted.lists = (List *) calloc(inversion.number_of_items, sizeof(List));
+     if ((inversion.counts == NULL || inverted.lists == NULL) && inversion.number_of_items > 0){
+          fprintf(stderr,"Error: Not enough memory to invert the database\n");
+          free(inversion.counts);
+          free(inverted.lists);
+          listdb_init(&inverted);
+          return inverted;
+     }
+     inverted.size = inversion.number_of_items;
+     inverted.dim = listdb->size;
+
+     parallel_for(inversion.number_of_threads, inversion.number_of_threads, listdb_invert_count, &inversion);
+
+     // sizes of the inverted lists and offsets of each thread in them
+     for (i = 0; i < inversion.number_of_items; i++){
+          uint size = 0;
+          for (t = 0; t < inversion.number_of_threads; t++){
+               uint *count = &inversion.counts[(size_t) t * inversion.number_of_items + i];
+               uint offset = size;
+               size += *count;
+               *count = offset;
+          }
+
+          if (size > 0){
+               inverted.lists[i].data = (Item *) malloc(size * sizeof(Item));
+               if (inverted.lists[i].data == NULL){
+                    fprintf(stderr,"Error: Not enough memory to invert the database\n");
+                    free(inversion.counts);
+                    listdb_destroy(&inverted);
+                    return inverted;
+               }
+          }
+          inverted.lists[i].size = size;
+     }
+
+     parallel_for(inversion.number_of_threads, inversion.number_of_threads, listdb_invert_scatter, &inversion);
+     free(inversion.counts);
+
+     return inverted;
+}
+
 /**
  * @brief Loads a list database from a file
  *        Format: 
@@ -0,0 +1,314 @@
+/**
+ * @file locations.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Locations of the IDs stored in a multi-table index, which allow
+ *        single IDs to be deleted or updated in O(number of tables). The
+ *        bucket of each ID in each table is recorded with a version that
+ *        is incremented whenever the ID moves, and entries keep the version
+ *        of their ID in their frequency. An entry is valid only if its
+ *        bucket and version are the recorded ones for its ID and table and
+ *        the ID has not been deleted, so an ID that returns to a bucket does
+ *        not revive its old entry there. Deleting an ID thus only sets its
+ *        tombstone, and moving an ID to another bucket only records the new
+ *        bucket: the old entries become stale and are skipped by queries
+ *        until the buckets are compacted, which happens once stale entries
+ *        exceed LOCATIONS_MAX_STALE of all the entries.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "locations.h"
+
+/**
+ * @brief Initializes a locations structure with no IDs
+ *
+ * @param locations Locations structure
+ * @param number_of_tables Number of tables of the index
+ */
+void locations_init(Locations *locations, uint number_of_tables)
+{
+     locations->number_of_tables = number_of_tables;
+     locations->size = 0;
+     locations->capacity = 0;
+     locations->buckets = NULL;
+     locations->versions = NULL;
+     locations->deleted = NULL;
+     locations->number_of_entries = 0;
+     locations->number_of_stale = 0;
+}
+
+/**
+ * @brief Destroys a locations structure
+ *
+ * @param locations Locations structure
+ */
+void locations_destroy(Locations *locations)
+{
+     free(locations->buckets);
+     free(locations->versions);
+     free(locations->deleted);
+     locations_init(locations, locations->number_of_tables);
+}
+
+/**
+ * @brief Makes room for the IDs smaller than a given size. New IDs are not
+ *        stored in any table. The capacity is doubled as needed.
+ *
+ * @param locations Locations structure
+ * @param size Number of IDs
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int locations_reserve(Locations *locations, uint size)
+{
+     if (size > locations->capacity){
+          uint capacity = locations->capacity ? locations->capacity : LOCATIONS_MIN_CAPACITY;
+          while (capacity < size && capacity < 0x80000000U)
+               capacity <<= 1;
+          if (capacity < size)
+               capacity = size;
+
+          uint *buckets = (uint *) realloc(locations->buckets,
+                                           (size_t) capacity * locations->number_of_tables * sizeof(uint));
+          if (buckets == NULL)
+               return LSH_NO_MEMORY;
+          locations->buckets = buckets;
+
+          uint *versions = (uint *) realloc(locations->versions,
+                                            (size_t) capacity * locations->number_of_tables * sizeof(uint));
+          if (versions == NULL)
+               return LSH_NO_MEMORY;
+          locations->versions = versions;
+
+          uchar *deleted = (uchar *) realloc(locations->deleted, capacity * sizeof(uchar));
+          if (deleted == NULL)
+               return LSH_NO_MEMORY;
+          locations->deleted = deleted;
+          locations->capacity = capacity;
+     }
+
+     if (size > locations->size){
+          memset(locations->buckets + (size_t) locations->size * locations->number_of_tables, 0xff,
+                 (size_t) (size - locations->size) * locations->number_of_tables * sizeof(uint));
+          memset(locations->versions + (size_t) locations->size * locations->number_of_tables, 0,
+                 (size_t) (size - locations->size) * locations->number_of_tables * sizeof(uint));
+          memset(locations->deleted + locations->size, 0, (size - locations->size) * sizeof(uchar));
+          locations->size = size;
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Computes the entry that locations_store will require for an ID in
+ *        a bucket of a table, without recording anything. It lets indexes
+ *        store the entries of all their tables before recording any
+ *        location. The ID must have been reserved.
+ *
+ * @param locations Locations structure
+ * @param id ID
+ * @param table Number of the table
+ * @param bucket New bucket of the ID
+ * @param entry New entry to be stored in the bucket (item: ID, freq: version)
+ *
+ * @return 1 if the new entry must be stored in the bucket, 0 otherwise
+ */
+int locations_entry(Locations *locations, uint id, uint table, uint bucket, Item *entry)
+{
+     size_t position = (size_t) id * locations->number_of_tables + table;
+
+     if (locations->buckets[position] == bucket)
+          return 0;
+
+     entry->item = id;
+     entry->freq = locations->versions[position] + 1;
+
+     return 1;
+}
+
+/**
+ * @brief Records the bucket of an ID in a table. If the ID already has an
+ *        entry in that bucket, the entry is reused (and becomes valid again
+ *        if the ID was deleted); otherwise a valid entry of the ID in its
+ *        previous bucket becomes stale. The ID must have been reserved.
+ *
+ * @param locations Locations structure
+ * @param id ID
+ * @param table Number of the table
+ * @param bucket New bucket of the ID
+ * @param entry New entry to be stored in the bucket (item: ID, freq: version)
+ *
+ * @return 1 if the new entry must be stored in the bucket, 0 otherwise
+ */
+int locations_store(Locations *locations, uint id, uint table, uint bucket, Item *entry)
+{
+     size_t position = (size_t) id * locations->number_of_tables + table;
+     uint *location = &locations->buckets[position];
+
+     if (*location == bucket){
+          if (locations->deleted[id])
+               locations->number_of_stale--;
+          return 0;
+     }
+
+     if (*location != LSH_NO_INDEX && !locations->deleted[id])
+          locations->number_of_stale++;
+     *location = bucket;
+     locations->number_of_entries++;
+
+     entry->item = id;
+     entry->freq = ++locations->versions[position];
+
+     return 1;
+}
+
+/**
+ * @brief Sets the tombstone of an ID, making all its entries stale
+ *
+ * @param locations Locations structure
+ * @param id ID
+ *
+ * @return LSH_OK, or LSH_INVALID if the ID is not stored
+ */
+int locations_delete(Locations *locations, uint id)
+{
+     uint i, stored = 0;
+     uint *location;
+
+     if (id >= locations->size || locations->deleted[id])
+          return LSH_INVALID;
+
+     location = &locations->buckets[(size_t) id * locations->number_of_tables];
+     for (i = 0; i < locations->number_of_tables; i++)
+          if (location[i] != LSH_NO_INDEX)
+               stored++;
+     if (stored == 0)
+          return LSH_INVALID;
+
+     locations->deleted[id] = 1;
+     locations->number_of_stale += stored;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Clears the tombstone of an ID after its buckets have been
+ *        recorded with locations_store. Entries of a deleted ID that were
+ *        not reused stay stale.
+ *
+ * @param locations Locations structure
+ * @param id ID
+ */
+void locations_undelete(Locations *locations, uint id)
+{
+     locations->deleted[id] = 0;
+}
+
+/**
+ * @brief Checks whether an entry of a bucket is valid
+ *
+ * @param locations Locations structure
+ * @param entry Entry (item: ID, freq: version)
+ * @param table Number of the table
+ * @param bucket Bucket of the entry
+ *
+ * @return 1 if the entry is valid, 0 if it is stale
+ */
+int locations_is_valid(Locations *locations, Item entry, uint table, uint bucket)
+{
+     size_t position = (size_t) entry.item * locations->number_of_tables + table;
+
+     return entry.item < locations->size && !locations->deleted[entry.item] &&
+          locations->buckets[position] == bucket && locations->versions[position] == entry.freq;
+}
+
+/**
+ * @brief Checks whether the stale entries exceed LOCATIONS_MAX_STALE of all
+ *        the entries
+ *
+ * @param locations Locations structure
+ *
+ * @return 1 if the buckets should be compacted, 0 otherwise
+ */
+int locations_need_compaction(Locations *locations)
+{
+     return locations->number_of_stale > 0 &&
+          (double) locations->number_of_stale > LOCATIONS_MAX_STALE * locations->number_of_entries;
+}
+
+/**
+ * @brief Removes the stale entries of a bucket, keeping the order of the
+ *        valid ones
+ *
+ * @param locations Locations structure
+ * @param table Number of the table
+ * @param bucket Number of the bucket
+ * @param items Entries of the bucket
+ */
+void locations_filter(Locations *locations, uint table, uint bucket, List *items)
+{
+     uint i, size = 0;
+
+     for (i = 0; i < items->size; i++)
+          if (locations_is_valid(locations, items->data[i], table, bucket))
+               items->data[size++] = items->data[i];
+
+     locations->number_of_entries -= items->size - size;
+     items->size = size;
+}
+
+/**
+ * @brief Appends the IDs of the valid entries of a bucket to a list with
+ *        enough room for them, with frequency 1. Entries are not checked if
+ *        the index has no stale entries.
+ *
+ * @param locations Locations structure
+ * @param table Number of the table
+ * @param bucket Number of the bucket
+ * @param items Entries of the bucket
+ * @param list List where IDs are appended
+ */
+void locations_append(Locations *locations, uint table, uint bucket, List *items, List *list)
+{
+     uint i;
+     int check = locations->number_of_stale > 0;
+
+     for (i = 0; i < items->size; i++){
+          if (check && !locations_is_valid(locations, items->data[i], table, bucket))
+               continue;
+          list->data[list->size].item = items->data[i].item;
+          list->data[list->size].freq = 1;
+          list->size++;
+     }
+}
+
+/**
+ * @brief Forgets the buckets of deleted IDs once all the buckets have been
+ *        filtered, so no stale entries are left
+ *
+ * @param locations Locations structure
+ */
+void locations_compacted(Locations *locations)
+{
+     uint i;
+
+     for (i = 0; i < locations->size; i++)
+          if (locations->deleted[i])
+               memset(&locations->buckets[(size_t) i * locations->number_of_tables], 0xff,
+                      locations->number_of_tables * sizeof(uint));
+     locations->number_of_stale = 0;
+}
@@ -19,10 +19,15 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <float.h>
 #include "mt64.h"
 #include "lplsh.h"
+#include "univhash.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "parallel.h"
 
 /**
  * @Brief Generates normally distributed numbers using the Box-Muller transform
@@ -105,11 +110,7 @@ void lplsh_print_head(HashTableLP *hash_table)
 
      printf("a: ");
      for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->a[i]);
-
-     printf("\nb: ");
-     for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->b[i]);
+          printf("%llu ", hash_table->a[i]);
      printf("\n");
 }
 
@@ -144,8 +145,11 @@ void lplsh_init(HashTableLP *hash_table)
      hash_table->width  = 0;
      hash_table->buckets = NULL;
      list_init(&hash_table->used_buckets);
+     hash_table->storage = NULL;
+     arena_init(&hash_table->arena);
+     bucketdir_init(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
      hash_table->a = NULL;
-     hash_table->b = NULL;
 }
 
 /**
@@ -160,7 +164,7 @@ void lplsh_rng_init(unsigned long long seed)
 /**
  * @brief Creates a hash table structure for performing LSH.
  *
- * @param table_size Size of the hash table
+ * @param table_size Initial number of buckets of the hash table (it grows as needed)
  * @param tuple_size Number of hash functions per sketch
  * @param dim Dimensions of the vectors to be hashed
  *
@@ -180,14 +184,15 @@ HashTableLP lplsh_create(uint table_size, uint tuple_size, uint dim, double widt
      hash_table.bval = (double *) malloc(tuple_size *  sizeof(double));
      hash_table.buckets = (BucketLP *) calloc(table_size, sizeof(BucketLP));
      list_init(&hash_table.used_buckets);
+     hash_table.storage = NULL;
+     arena_init(&hash_table.arena);
+     hash_table.directory = bucketdir_create(table_size);
+     hash_table.number_of_buckets = 0;
 
      // generates array of random values for universal hashing
-     hash_table.a = (uint *) malloc(tuple_size * sizeof(uint));
-     hash_table.b = (uint *) malloc(tuple_size * sizeof(uint));
-     for (i = 0; i < tuple_size; i++){
-          hash_table.a[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-          hash_table.b[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-     }
+     hash_table.a = (ullong *) malloc(tuple_size * sizeof(ullong));
+     for (i = 0; i < tuple_size; i++)
+          hash_table.a[i] = univhash_coefficient(genrand64_int64());
      
      return hash_table;
 }
@@ -200,55 +205,28 @@ HashTableLP lplsh_create(uint table_size, uint tuple_size, uint dim, double widt
  */
 void lplsh_erase_from_vector(Vector *vector, HashTableLP *hash_table)
 {  
-     uint index = lplsh_get_index(vector, hash_table);
-     list_destroy(&hash_table->buckets[index].items);
-     hash_table->buckets[index].hash_value = 0;
-     
-     Item item = {index, 1};
-     Item *ptr = list_find(&hash_table->used_buckets, item);
-     uint position = (uint) (ptr - hash_table->used_buckets.data);
-     list_delete_position(&hash_table->used_buckets, position);
-}
-
-/**
- * @brief Removes items in a given bucket of the hash table
- *
- * @param index Index of the bucket to be removed
- * @param hash_table Hash table structure
- */
-void lplsh_erase_from_index(uint index, HashTableLP *hash_table)
-{  
-     if (index >= 0 && index < hash_table->table_size){
-          // destroy bucket
-          list_destroy(&hash_table->buckets[index].items);
-          hash_table->buckets[index].hash_value = 0;
-
-          // delete bucket index from list of used buckets
-          Item item = {index, 1};
-          Item *ptr = list_find(&hash_table->used_buckets, item);
-          uint position = (uint) (ptr - hash_table->used_buckets.data);
-          list_delete_position(&hash_table->used_buckets, position);
-     } else {
-          printf("Index %u out of range! Table size is %u", index, hash_table->table_size);
-     }
+     uint index = bucketdir_find(&hash_table->directory, lplsh_univhash(vector, hash_table));
+     if (index != LSH_NO_INDEX)
+          lplsh_erase_from_index(index, hash_table);
 }
 
 /**
- * @brief Removes the items in all the used buckets of the hash table
+ * @brief Removes the items in all the used buckets of the hash table.
+ *        The IDs are released at once by rewinding the arena, and the
+ *        bucket directory is emptied in time proportional to its capacity.
  *
  * @param hash_table Hash table structure
  */
 void lplsh_clear_table(HashTableLP *hash_table)
 {  
-     uint i;
-
-     // empties used buckets of a hash table
-     for (i = 0; i < hash_table->used_buckets.size; i++) {
-          list_destroy(&hash_table->buckets[hash_table->used_buckets.data[i].item].items);
-          hash_table->buckets[hash_table->used_buckets.data[i].item].hash_value = 0;
-     }
-
+     // releases the IDs of all the buckets at once
+     arena_rewind(&hash_table->arena);
+     hash_table->storage = NULL;
      list_destroy(&hash_table->used_buckets);
+
+     // buckets are kept allocated for the next tuples
+     bucketdir_clear(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
 }
 
 /**
@@ -261,8 +239,9 @@ void lplsh_destroy(HashTableLP *hash_table)
      free(hash_table->avec);
      free(hash_table->bval);
      free(hash_table->buckets);
+     arena_destroy(&hash_table->arena);
+     bucketdir_destroy(&hash_table->directory);
      free(hash_table->a);
-     free(hash_table->b);
      list_destroy(&hash_table->used_buckets);
      lplsh_init(hash_table);
 }
@@ -288,6 +267,19 @@ void lplsh_generate_random_values(uint tuple_size, uint dim, double width,
      }
 }
 
+/**
+ * @brief Draws new random values for a hash table, so that the table can be
+ *        cleared and reused for another tuple.
+ *
+ * @param hash_table Hash table structure
+ * @param ps_dist p-stable distribution
+ */
+void lplsh_generate_functions(HashTableLP *hash_table, double (*ps_dist)(void))
+{
+     lplsh_generate_random_values(hash_table->tuple_size, hash_table->dim, hash_table->width,
+                                  hash_table->avec, hash_table->bval, ps_dist);
+}
+
 /**
  * @brief Computes the hash value of a positive-integer-valued vector according to 
  * 
@@ -312,111 +304,251 @@ ullong lplsh_compute_hash_value(Vector *vector, double *avec, double bval, doubl
 }
 
 /**
- * @brief Universal hashing for getting a hash table index from the corresponding hash value tuple
+ * @brief Universal hashing of the hash value tuple of a vector
  *
  * @param vector Vector to be hashed
  * @param hash_table Hash table structure
- * @param hash_value Hash value
- * @param index Table index
+ *
+ * @return 2nd-level hash value
  */
-void lplsh_univhash(Vector *vector, HashTableLP *hash_table, uint *hash_value, uint *index)
+ullong lplsh_univhash(Vector *vector, HashTableLP *hash_table)
 {
      uint i;
      ullong hv;
-     __uint128_t temp_index = 0;
-     __uint128_t temp_hv = 0;
+     ullong hash_value = 0;
 
-     // computes MinHash values
+     // computes hash values and accumulates them modulo 2^61 - 1
      for (i = 0; i < hash_table->tuple_size; i++){
           hv = lplsh_compute_hash_value(vector, &hash_table->avec[i * hash_table->dim], hash_table->bval[i], hash_table->width);
-          temp_index += ((ullong) hash_table->a[i]) * hv;
-          temp_hv += ((ullong) hash_table->b[i]) * hv; 
+          hash_value = univhash_add(hash_value, hash_table->a[i], hv);
      }
 
-     // computes 2nd-level hash value and index (universal hash functions)
-     *hash_value = (temp_hv % LARGEST_PRIME64);   
-     *index = (temp_index % LARGEST_PRIME64) % hash_table->table_size;
+     return hash_value;
 }
 
+// bucket engine of the hash table (see lshtable.h)
+#define LSH_PREFIX lplsh
+#define LSH_TABLE HashTableLP
+#define LSH_BUCKET BucketLP
+#define LSH_INDEX HashIndexLP
+#define LSH_OBJECT Vector
+#define LSH_OBJECT_NAME vector
+#define LSH_DB VectorDB
+#define LSH_DB_NAME vectordb
+#define LSH_DB_OBJECTS vectors
+#define LSH_KEY(object, hash_table) lplsh_univhash(object, hash_table)
+#include "lshtable.h"
+
 /**
- * @brief Computes 2nd-level hash value of lists using open 
- *        adressing collision resolution and linear probing.
- * @todo Add other probing strategies.
+ * @brief Stores lists in the hash table.
  *
- * @param vector Vector to be hashed
- * @param hash_table Hash table structure
+ * @param listdb Database of lists to be hashed
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets
  *
- * @return index of the hash table
+ * @return LSH_OK on success, LSH_NO_MEMORY if a vector could not be stored
  */ 
-uint lplsh_get_index(Vector *vector, HashTableLP *hash_table)
+int lplsh_store_vectordb(VectorDB *vectordb, HashTableLP *hash_table, uint *indices)
 {
-     uint checked_buckets, index, hash_value;
+     uint i;
      
-     lplsh_univhash(vector, hash_table, &hash_value, &index);
-     if (hash_table->buckets[index].items.size != 0){ // examine buckets (open adressing)
-          if (hash_table->buckets[index].hash_value != hash_value){
-               checked_buckets = 1;
-               while (checked_buckets < hash_table->table_size){ // linear probing
-                    index = ((index + 1) & (hash_table->table_size - 1));
-                    if (hash_table->buckets[index].items.size != 0){
-                         if (hash_table->buckets[index].hash_value == hash_value)
-                              break;   
-                    } else {
-                         hash_table->buckets[index].hash_value = hash_value; 
-                         break;
-                    }
-                    checked_buckets++;      
-               }
-               
-               if (checked_buckets == hash_table->table_size){
-                    fprintf(stderr,"Error: The hash table is full!\n ");
-                    exit(EXIT_FAILURE);
-               }
-          }
-     } else {
-          hash_table->buckets[index].hash_value = hash_value; 
+     // hash all vectors in the database
+     for (i = 0; i < vectordb->size; i++){
+          indices[i] = lplsh_store_vector(&vectordb->vectors[i], i, hash_table);
+          if (indices[i] == LSH_NO_INDEX)
+               return LSH_NO_MEMORY;
      }
-     
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Initializes a multi-table LPLSH index structure to zero
+ *
+ * @param index Hash index structure
+ */
+void lplsh_index_init(HashIndexLP *index)
+{
+     index->number_of_tables = 0;
+     index->hash_tables = NULL;
+     locations_init(&index->locations, 0);
+}
+
+/**
+ * @brief Creates an index of number_of_tables hash tables, each with its
+ *        own random projections
+ *
+ * @param number_of_tables Number of hash tables
+ * @param table_size Initial number of buckets of each hash table
+ * @param tuple_size Number of hash functions per tuple
+ * @param dim Dimensionality of the vectors
+ * @param width Width of the quantization bins
+ * @param ps_dist Function to draw the random projections (p-stable distribution)
+ *
+ * @return Hash index structure
+ */
+HashIndexLP lplsh_index_create(uint number_of_tables, uint table_size, uint tuple_size, uint dim,
+                               double width, double (*ps_dist)(void))
+{
+     uint i;
+     HashIndexLP index;
+
+     lplsh_index_init(&index);
+     index.number_of_tables = number_of_tables;
+     locations_init(&index.locations, number_of_tables);
+     index.hash_tables = (HashTableLP *) malloc(number_of_tables * sizeof(HashTableLP));
+     for (i = 0; i < number_of_tables; i++){
+          index.hash_tables[i] = lplsh_create(table_size, tuple_size, dim, width);
+          lplsh_generate_random_values(tuple_size, dim, width, index.hash_tables[i].avec,
+                                       index.hash_tables[i].bval, ps_dist);
+     }
+
      return index;
 }
 
 /**
- * @brief Stores lists in the hash table.
+ * @brief Destroys a multi-table LPLSH index structure
  *
- * @param list List to be hashed
- * @param id ID of the list
- * @param hash_table Hash table
- */ 
-uint lplsh_store_vector(Vector *vector, uint id, HashTableLP *hash_table)
+ * @param index Hash index structure
+ */
+void lplsh_index_destroy(HashIndexLP *index)
+{
+     uint i;
+
+     for (i = 0; i < index->number_of_tables; i++)
+          lplsh_destroy(&index->hash_tables[i]);
+     free(index->hash_tables);
+     locations_destroy(&index->locations);
+     lplsh_index_init(index);
+}
+
+/**
+ * @brief Stores an ID in its bucket of each table and records its
+ *        locations. Tables where the ID stays in the same bucket are not
+ *        modified.
+ *        If the ID cannot be stored in every table, the index is left as it
+ *        was (see index_store_buckets in lshtable.h).
+ *
+ * @param index Hash index structure
+ * @param id ID of the vector (reserved in the locations of the index)
+ * @param vector Vector to be stored
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+static int lplsh_index_store(HashIndexLP *index, uint id, Vector *vector)
 {
-     uint index;
+     uint j;
+     int status = LSH_OK;
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+
+     if (buckets == NULL)
+          return LSH_NO_MEMORY;
 
-     // get index of the hash table
-     index = lplsh_get_index(vector, hash_table);
-     if (hash_table->buckets[index].items.size == 0){ // mark used bucket
-          Item new_used_bucket = {index, 1};
-          list_push(&hash_table->used_buckets, new_used_bucket);
+     for (j = 0; j < index->number_of_tables && status == LSH_OK; j++){
+          buckets[j] = lplsh_get_index(vector, &index->hash_tables[j]);
+          if (buckets[j] == LSH_NO_INDEX)
+               status = LSH_NO_MEMORY;
      }
+     if (status == LSH_OK)
+          status = lplsh_index_store_buckets(index, id, buckets);
 
-     // store list id in the hash table
-     Item new_item = {id, 1};
-     list_push(&hash_table->buckets[index].items, new_item);
+     free(buckets);
 
-     return index;
+     return status;
 }
 
 /**
- * @brief Stores lists in the hash table.
+ * @brief Stores the vectors of a database in all the tables of an index.
+ *        Each vector is stored in all the tables before moving to the next
+ *        one, so the vector is only read while it is in cache.
  *
- * @param listdb Database of lists to be hashed
- * @param hash_table Hash table
- * @param indices Indices of the used buckets
- */ 
-void lplsh_store_vectordb(VectorDB *vectordb, HashTableLP *hash_table, uint *indices)
+ * @param index Hash index structure
+ * @param vectordb Database of vectors
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int lplsh_index_build(HashIndexLP *index, VectorDB *vectordb)
 {
      uint i;
-     
-     // hash all vectors in the database
-     for (i = 0; i < vectordb->size; i++)
-          indices[i] = lplsh_store_vector(&vectordb->vectors[i], i, hash_table);
+     int status = LSH_OK;
+
+     if (locations_reserve(&index->locations, vectordb->size) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     for (i = 0; i < vectordb->size && status == LSH_OK; i++)
+          status = lplsh_index_store(index, i, &vectordb->vectors[i]);
+
+     return status;
+}
+
+/**
+ * @brief Inserts a vector in the index or replaces a stored vector with
+ *        the same ID. The vector is moved only in the tables where its
+ *        bucket changes; its old entries become stale (see
+ *        lplsh_index_delete).
+ *
+ * @param index Hash index structure
+ * @param id ID of the vector
+ * @param vector New vector
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int lplsh_index_update(HashIndexLP *index, uint id, Vector *vector)
+{
+     int status;
+
+     if (locations_reserve(&index->locations, id + 1) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     status = lplsh_index_store(index, id, vector);
+     if (locations_need_compaction(&index->locations))
+          lplsh_index_compact(index);
+
+     return status;
+}
+
+/**
+ * @brief Retrieves the IDs stored in the index that collide with a vector in
+ *        at least one table. Buckets are only looked up, so querying does
+ *        not modify the tables.
+ *
+ * @param index Hash index structure
+ * @param query Vector to be queried
+ *
+ * @return Sorted list of candidate IDs, whose frequencies are the numbers
+ *         of tables where they collide with the query
+ */
+List lplsh_index_query(HashIndexLP *index, Vector *query)
+{
+     uint i;
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+     size_t number_of_candidates = 0;
+     List candidates;
+
+     list_init(&candidates);
+     if (buckets == NULL)
+          return candidates;
+
+     // finds the bucket of the query in each table
+     for (i = 0; i < index->number_of_tables; i++){
+          HashTableLP *hash_table = &index->hash_tables[i];
+          buckets[i] = bucketdir_find(&hash_table->directory, lplsh_univhash(query, hash_table));
+          if (buckets[i] != LSH_NO_INDEX)
+               number_of_candidates += hash_table->buckets[buckets[i]].items.size;
+     }
+
+     // merges the buckets and removes repeated IDs
+     candidates.data = (Item *) malloc(number_of_candidates * sizeof(Item));
+     if (candidates.data != NULL){
+          for (i = 0; i < index->number_of_tables; i++)
+               if (buckets[i] != LSH_NO_INDEX)
+                    locations_append(&index->locations, i, buckets[i],
+                                     &index->hash_tables[i].buckets[buckets[i]].items, &candidates);
+          list_sort_by_item(&candidates);
+          list_unique(&candidates);
+     }
+
+     free(buckets);
+
+     return candidates;
 }
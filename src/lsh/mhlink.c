@@ -24,6 +24,49 @@
 #include <string.h>
 #include "mhlink.h"
 
+/**
+ * @brief Stores lists in a hash table of the clustering functions with the
+ *        number of threads of the clustering options. Clusters do not
+ *        depend on the number of threads.
+ *
+ * @param listdb Database of lists
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets
+ * @param options Clustering options (NULL for a single thread)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID
+ */
+int mhlink_store_listdb(ListDB *listdb, HashTableMH *hash_table, uint *indices, MHLinkOptions *options)
+{
+     if (options == NULL || options->number_of_threads == 1)
+          return mh_store_listdb_bulk(listdb, hash_table, indices);
+
+     return mh_store_listdb_parallel(listdb, hash_table, indices, options->number_of_threads);
+}
+
+/**
+ * @brief Creates the hash table used by the clustering functions with the
+ *        bucket limit of the clustering options (see mh_set_bucket_limit)
+ *
+ * @param table_size Initial number of buckets of the hash table
+ * @param tuple_size Number of MinHash values per tuple
+ * @param dim Size of the vocabulary
+ * @param scheme MinHash scheme
+ * @param options Clustering options (NULL for no limit)
+ *
+ * @return Hash table structure
+ */
+HashTableMH mhlink_create_table(uint table_size, uint tuple_size, uint dim, uint scheme,
+                                MHLinkOptions *options)
+{
+     HashTableMH hash_table = mh_create_scheme(table_size, tuple_size, dim, scheme);
+
+     if (options != NULL && options->max_bucket_size > 0)
+          mh_set_bucket_limit(&hash_table, options->max_bucket_size, options->bucket_policy);
+
+     return hash_table;
+}
+
 /**
  * @brief Converts clusters (lists of ids) to lists of items.
  *
@@ -46,19 +89,61 @@ ListDB mhlink_make_model(ListDB *listdb, ListDB *clusters)
      return models;
 }
 
+/**
+ * @brief Adds a neighbor list to the cluster of a list, merging both
+ *        clusters if the neighbor already belongs to another one.
+ *
+ * @param clusters Generated clusters
+ * @param listid ID of the list
+ * @param neighbor ID of the neighbor list
+ * @param checked Keeps track of the already checked lists
+ * @param clus_table Keeps track of the cluster to which each list is
+ *                   assigned
+ */
+void mhlink_merge_neighbor(ListDB *clusters, uint listid, uint neighbor, uint *checked,
+                           uint *clus_table)
+{
+     if (checked[neighbor] == 0) { // list doesn't belong to a cluster
+          // Add item to cluster
+          Item new_item = {neighbor, 1};
+          list_push(&clusters->lists[clus_table[listid]], new_item);
+
+          // mark list as checked
+          checked[neighbor] = 1;
+
+          // assigning current id to new item
+          clus_table[neighbor] = clus_table[listid];
+     } else if (clus_table[neighbor] != clus_table[listid]) { // otherwise
+          // get min and max between cluster ids
+          uint max_clusid = max(clus_table[neighbor], clus_table[listid]);
+          uint min_clusid = min(clus_table[neighbor], clus_table[listid]);
+
+          // Merge clusters
+          list_append(&clusters->lists[min_clusid], &clusters->lists[max_clusid]);
+
+          // reassigning ids to cluster with largest id
+          uint j;
+          for (j = 0; j < clusters->lists[max_clusid].size; j++)
+               clus_table[clusters->lists[max_clusid].data[j].item] = min_clusid;
+
+          // Destroy cluster with largest id
+          list_destroy(&clusters->lists[max_clusid]);                         
+     }
+}
+
 /**
  * @brief Checks a hash bucket for similar lists to be merged in a
  *        cluster.
  *
  * @param listdb Database of lists
  * @param clusters Generated clusters
- * @param index Index of the list in the hash table
  * @param Listid ID of the list to be added
- * @param hash_table Hash table
+ * @param items IDs of the lists in the bucket
  * @param checked Keeps track of the already checked lists
  * @param clus_table Keeps track of the cluster to which each list is
  *                   assigned
- * @param ovr_th Threshold to merge clusters
+ * @param sim Similarity function for adding list to a cluster
+ * @param thres Threshold to merge clusters
  */
 void mhlink_add_neighbors(ListDB *listdb, ListDB *clusters, uint listid, List *items, uint *checked,
                           uint *clus_table, double (*sim)(List *, List *), double thres)
@@ -67,57 +152,129 @@ void mhlink_add_neighbors(ListDB *listdb, ListDB *clusters, uint listid, List *i
      for (i = 0; i < items->size; i++) {
           if (items->data[i].item != listid) {
                // add neighbor item if similarity is greater than a threshold
-               if (sim(&listdb->lists[listid], &listdb->lists[items->data[i].item]) > thres) {
-                    if (checked[items->data[i].item] == 0) { // list doesn't belong to a cluster
-                         // Add item to cluster
-                         Item new_item = {items->data[i].item, 1};
-                         list_push(&clusters->lists[clus_table[listid]], new_item);
-
-                         // mark list as checked
-                         checked[items->data[i].item] = 1;
-
-                         // assigning current id to new item
-                         clus_table[items->data[i].item] = clus_table[listid];
-                    } else if (clus_table[items->data[i].item] != clus_table[listid]) { // otherwise
-                         // get min and max between cluster ids
-                         uint max_clusid = max(clus_table[items->data[i].item], clus_table[listid]);
-                         uint min_clusid = min(clus_table[items->data[i].item], clus_table[listid]);
-
-                         // Merge clusters
-                         list_append(&clusters->lists[min_clusid], &clusters->lists[max_clusid]);
-
-                         // reassigning ids to cluster with largest id
-                         uint j;
-                         for (j = 0; j < clusters->lists[max_clusid].size; j++)
-                              clus_table[clusters->lists[max_clusid].data[j].item] = min_clusid;
-
-                         // Destroy cluster with largest id
-                         list_destroy(&clusters->lists[max_clusid]);                         
-                    }
-               }
+               if (sim(&listdb->lists[listid], &listdb->lists[items->data[i].item]) > thres)
+                    mhlink_merge_neighbor(clusters, listid, items->data[i].item, checked, clus_table);
           }
      }
 }
 
 /**
- * @brief Single-link clustering based on Min-Hashing without weighting.
+ * @brief Checks a hash bucket for similar lists to be merged in a
+ *        cluster, estimating the Jaccard similarity from b-bit signatures.
+ *
+ * @param signatures b-bit signature matrix of the database of lists
+ * @param clusters Generated clusters
+ * @param Listid ID of the list to be added
+ * @param items IDs of the lists in the bucket
+ * @param checked Keeps track of the already checked lists
+ * @param clus_table Keeps track of the cluster to which each list is
+ *                   assigned
+ * @param thres Threshold to merge clusters
+ */
+void mhlink_add_bbit_neighbors(BbitSignatureDB *signatures, ListDB *clusters, uint listid, List *items,
+                               uint *checked, uint *clus_table, double thres)
+{
+     uint i;
+     for (i = 0; i < items->size; i++) {
+          if (items->data[i].item != listid) {
+               // add neighbor item if estimated similarity is greater than a threshold
+               if (mh_bbit_jaccard(signatures, listid, items->data[i].item) > thres)
+                    mhlink_merge_neighbor(clusters, listid, items->data[i].item, checked, clus_table);
+          }
+     }
+}
+
+/**
+ * @brief Links the lists stored in a hash table to the clusters of the
+ *        lists that share their bucket.
+ *
+ * @param listdb Database of lists
+ * @param clusters Generated clusters
+ * @param hash_table Hash table where the lists are stored
+ * @param indices Bucket index of each list
+ * @param checked Keeps track of the already checked lists
+ * @param clus_table Keeps track of the cluster to which each list is
+ *                   assigned
+ * @param sim Similarity function for adding list to a cluster
+ * @param bbit b-bit signatures used instead of sim if not NULL
+ * @param thres Threshold for adding list to a cluster
+ */
+void mhlink_link_table(ListDB *listdb, ListDB *clusters, HashTableMH *hash_table, uint *indices,
+                       uint *checked, uint *clus_table, double (*sim)(List *, List *),
+                       BbitSignatureDB *bbit, double thres)
+{
+     uint j;
+
+     // applies the bucket policy and reports the buckets that overflowed
+     if (mh_limit_buckets(hash_table, listdb, indices) != LSH_OK)
+          fprintf(stderr,"Error: Could not apply the bucket policy, some buckets were not limited\n");
+     if (hash_table->overflowed.size > 0){
+          uint largest = list_max_freq(&hash_table->overflowed)->freq;
+          fprintf(stderr,"\nWarning: %u buckets had more than %u IDs (largest: %u)\n",
+                  hash_table->overflowed.size, hash_table->max_bucket_size, largest);
+     }
+
+     for (j = 0; j < listdb->size; j++){
+          if (checked[j] == 0){// list hasn't been checked
+               // a new cluster is formed
+               List new_cluster;
+               list_init(&new_cluster);
+
+               Item new_item = {j, 1};
+               list_push(&new_cluster, new_item);
+
+               clus_table[j] = clusters->size;
+               listdb_push(clusters, &new_cluster);
+
+               checked[j] = 1;
+          }
+
+          if (indices[j] == LSH_NO_INDEX)// empty lists are not stored
+               continue;
+
+          // assign items in the same bucket to the same cluster
+          if (bbit != NULL)
+               mhlink_add_bbit_neighbors(bbit, clusters, j, &hash_table->buckets[indices[j]].items,
+                                         checked, clus_table, thres);
+          else
+               mhlink_add_neighbors(listdb, clusters, j, &hash_table->buckets[indices[j]].items,
+                                    checked, clus_table, sim, thres);
+
+          // bucket has been processed
+          hash_table->buckets[indices[j]].items.size = 0;
+     }
+
+     // empties buckets and list of used buckets
+     mh_clear_table(hash_table);
+}
+
+/**
+ * @brief Single-link clustering based on Min-Hashing with a given MinHash scheme.
  *
  * @param listdb Database of lists to be hashed
- * @param table_size Number of buckets in the hash table
  * @param tuple_size Number of MinHash values per tuple
+ * @param number_of_tuples Number of hash tables
+ * @param table_size Number of buckets in the hash table
+ * @param scheme MinHash scheme (MH_HASHED, MH_OPH, MH_WEIGHTED or MH_PERMUTATIONS)
+ * @param weights Weight of each item (NULL for unit weights)
  * @param sim Similarity function for adding list to a cluster
  * @param thres Threshold for adding list to a cluster
+ * @param min_cluster_size Smallest size of a cluster
+ * @param options Bucket limit and number of threads (NULL for no limit and
+ *        a single thread)
  *
  * @return Clusters of IDs
  */
-ListDB mhlink_cluster(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
-                      double (*sim)(List *, List *), double thres, uint min_cluster_size)
+ListDB mhlink_cluster_scheme(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
+                             uint scheme, double *weights, double (*sim)(List *, List *),
+                             double thres, uint min_cluster_size, MHLinkOptions *options)
 {
-     uint i, j;
+     uint i;
      uint *checked = (uint *) calloc(listdb->size, sizeof(uint));
      uint *clus_table = (uint *) malloc(listdb->size * sizeof(uint));
      uint *indices = (uint *) malloc(listdb->size * sizeof(uint));
-     HashTableMH hash_table = mh_create(table_size, tuple_size, listdb->dim);
+     HashTableMH hash_table = mhlink_create_table(table_size, tuple_size, listdb->dim, scheme, options);
+     hash_table.weights = weights;
      ListDB clusters;
      listdb_init(&clusters);
 
@@ -126,36 +283,15 @@ ListDB mhlink_cluster(ListDB *listdb, uint tuple_size, uint number_of_tuples, ui
                  i + 1, number_of_tuples, tuple_size, listdb->size);
 
           // stores lists in the hash table
-          mh_generate_permutations(listdb->dim, tuple_size, hash_table.permutations);
-          mh_store_listdb(listdb, &hash_table, indices);
-          
-          for (j = 0; j < listdb->size; j++){
-               if (checked[j] == 0){// list hasn't been checked
-                    // a new cluster is formed
-                    List new_cluster;
-                    list_init(&new_cluster);
-
-                    Item new_item = {j, 1};
-                    list_push(&new_cluster, new_item);
-
-                    clus_table[j] = clusters.size;
-                    listdb_push(&clusters, &new_cluster);
-
-                    checked[j] = 1;
-               }
-
-               // assign items in the same bucket to the same cluster
-               mhlink_add_neighbors(listdb, &clusters, j, &hash_table.buckets[indices[j]].items,
-                                    checked, clus_table, sim, thres);
-
-               // Freeing up bucket
-               list_destroy(&hash_table.buckets[indices[j]].items);
+          mh_generate_functions(&hash_table);
+          if (mhlink_store_listdb(listdb, &hash_table, indices, options) != LSH_OK){
+               fprintf(stderr,"Error: Could not store table %u\n", i + 1);
+               break;
           }
-
-          // cleaning list of used buckets
-          list_destroy(&hash_table.used_buckets);
+          mhlink_link_table(listdb, &clusters, &hash_table, indices, checked, clus_table, sim, NULL, thres);
      }
           
+     mh_destroy(&hash_table);
      free(indices);
      free(checked);
      free(clus_table);
@@ -168,72 +304,188 @@ ListDB mhlink_cluster(ListDB *listdb, uint tuple_size, uint number_of_tuples, ui
 }
 
 /**
- * @brief Single-link clustering based on Min-Hashing with weighting.
+ * @brief Single-link clustering based on Min-Hashing from a precomputed
+ *        signature matrix. Each band of tuple_size columns of the matrix
+ *        is stored in its own hash table, so the lists are not hashed
+ *        again and different tuple sizes can be tried on the same sketches.
  *
- * @param listdb Database of lists to be hashed
- * @param table_size Number of buckets in the hash table
+ * @param listdb Database of lists
+ * @param signatures Signature matrix of the database (see mh_sketch_listdb)
  * @param tuple_size Number of MinHash values per tuple
+ * @param table_size Number of buckets in the hash table
  * @param sim Similarity function for adding list to a cluster
  * @param thres Threshold for adding list to a cluster
+ * @param min_cluster_size Smallest size of a cluster
+ * @param options Bucket limit (NULL for no limit)
+ *
+ * @return Clusters of IDs
  */
-ListDB mhlink_cluster_weighted(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
-                               double *weights, double (*sim)(List *, List *), double thres,
-                               uint min_cluster_size)
+ListDB mhlink_cluster_signatures(ListDB *listdb, SignatureDB *signatures, uint tuple_size,
+                                 uint table_size, double (*sim)(List *, List *), double thres,
+                                 uint min_cluster_size, MHLinkOptions *options)
 {
-     uint i, j;
+     uint i;
+     uint number_of_tuples = signatures->number_of_values / tuple_size;
      uint *checked = (uint *) calloc(listdb->size, sizeof(uint));
      uint *clus_table = (uint *) malloc(listdb->size * sizeof(uint));
      uint *indices = (uint *) malloc(listdb->size * sizeof(uint));
-     HashTableMH hash_table = mh_create(table_size, tuple_size, listdb->dim);
+     HashTableMH hash_table = mhlink_create_table(table_size, tuple_size, listdb->dim, MH_HASHED, options);
      ListDB clusters;
      listdb_init(&clusters);
 
-     for (i = 0; i < number_of_tuples; i++){// computes each hash table
-          printf("Clustering table %u/%u: %u random permutations for %u lists\r",
+     for (i = 0; i < number_of_tuples; i++){// stores each band in a hash table
+          printf("Clustering table %u/%u: %u MinHash values for %u lists\r",
                  i + 1, number_of_tuples, tuple_size, listdb->size);
 
-          // stores lists in the hash table
-          mh_generate_permutations(listdb->dim, tuple_size, hash_table.permutations);
-          mh_weight_permutations(listdb->dim, tuple_size, hash_table.permutations, weights);
-          mh_store_listdb(listdb, &hash_table, indices);
+          if (mh_store_signatures_bulk(signatures, listdb, i, &hash_table, indices) != LSH_OK){
+               fprintf(stderr,"Error: Could not store table %u\n", i + 1);
+               break;
+          }
+          mhlink_link_table(listdb, &clusters, &hash_table, indices, checked, clus_table, sim, NULL, thres);
+     }
+          
+     mh_destroy(&hash_table);
+     free(indices);
+     free(checked);
+     free(clus_table);
 
-          // sorts used items in ascending order
-          list_sort_by_item(&hash_table.used_buckets);
+     listdb_delete_smallest(&clusters, min_cluster_size);
+     ListDB models = mhlink_make_model(listdb, &clusters);
+     listdb_destroy(&clusters);
+     
+     return models;
+}
 
-          for (j = 0; j < listdb->size; j++){
-               if (checked[j] == 0){// list hasn't been checked
-                    // a new cluster is formed
-                    List new_cluster;
-                    list_init(&new_cluster);
+/**
+ * @brief Single-link clustering based on Min-Hashing with signatures cached
+ *        in a file. If the cache file holds signatures computed with the
+ *        same scheme, seed, tuple size, number of tuples and database, they
+ *        are memory-mapped; otherwise the database is sketched and the cache
+ *        file is (re)written. Different thresholds and minimum cluster sizes
+ *        can thus be tried without sketching the database again.
+ *
+ * @param listdb Database of lists to be hashed
+ * @param tuple_size Number of MinHash values per tuple
+ * @param number_of_tuples Number of hash tables
+ * @param table_size Number of buckets in the hash table
+ * @param scheme MinHash scheme (MH_HASHED, MH_OPH, MH_WEIGHTED or MH_PERMUTATIONS)
+ * @param seed Seed of the random number generator
+ * @param cache_file Name of the cache file
+ * @param sim Similarity function for adding list to a cluster
+ * @param thres Threshold for adding list to a cluster
+ * @param min_cluster_size Smallest size of a cluster
+ * @param options Bucket limit (NULL for no limit)
+ *
+ * @return Clusters of IDs
+ */
+ListDB mhlink_cluster_cached(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
+                             uint scheme, ullong seed, char *cache_file,
+                             double (*sim)(List *, List *), double thres, uint min_cluster_size,
+                             MHLinkOptions *options)
+{
+     SignatureKey key = {scheme, tuple_size, number_of_tuples, seed, mh_listdb_fingerprint(listdb)};
+     SignatureDB signatures = mh_signatures_map(cache_file, &key);
 
-                    Item new_item = {j, 1};
-                    list_push(&new_cluster, new_item);
+     if (signatures.values == NULL){// sketches database and writes cache
+          mh_rng_init(seed);
+          HashTableMH sketcher = mh_create_scheme(0, tuple_size * number_of_tuples, listdb->dim, scheme);
+          mh_generate_functions(&sketcher);
+          signatures = mh_sketch_listdb(listdb, &sketcher);
+          mh_destroy(&sketcher);
+          mh_signatures_save(cache_file, &signatures, &key);
+     }
 
-                    clus_table[j] = clusters.size;
-                    listdb_push(&clusters, &new_cluster);
+     // same 2nd-level hash functions whether signatures were cached or not
+     mh_rng_init(seed);
+     ListDB models = mhlink_cluster_signatures(listdb, &signatures, tuple_size, table_size,
+                                               sim, thres, min_cluster_size, options);
+     mh_signatures_destroy(&signatures);
 
-                    checked[j] = 1;
-               }
+     return models;
+}
 
-               // assign items in the same bucket to the same cluster
-               mhlink_add_neighbors(listdb, &clusters, j, &hash_table.buckets[indices[j]].items,
-                                    checked, clus_table, sim, thres);
+/**
+ * @brief Single-link clustering based on Min-Hashing from b-bit signatures.
+ *        Both the bucketing and the similarity between lists use the b-bit
+ *        values, so the lists are only accessed to build the models.
+ *
+ * @param listdb Database of lists
+ * @param signatures b-bit signature matrix of the database (see mh_bbit_compress)
+ * @param tuple_size Number of b-bit values per tuple
+ * @param table_size Number of buckets in the hash table
+ * @param thres Threshold on the estimated Jaccard similarity for adding list to a cluster
+ * @param min_cluster_size Smallest size of a cluster
+ * @param options Bucket limit (NULL for no limit)
+ *
+ * @return Clusters of IDs
+ */
+ListDB mhlink_cluster_bbit(ListDB *listdb, BbitSignatureDB *signatures, uint tuple_size,
+                           uint table_size, double thres, uint min_cluster_size, MHLinkOptions *options)
+{
+     uint i;
+     uint number_of_tuples = signatures->number_of_values / tuple_size;
+     uint *checked = (uint *) calloc(listdb->size, sizeof(uint));
+     uint *clus_table = (uint *) malloc(listdb->size * sizeof(uint));
+     uint *indices = (uint *) malloc(listdb->size * sizeof(uint));
+     HashTableMH hash_table = mhlink_create_table(table_size, tuple_size, listdb->dim, MH_HASHED, options);
+     ListDB clusters;
+     listdb_init(&clusters);
 
-               // Freeing up bucket
-               list_destroy(&hash_table.buckets[indices[j]].items);
-          }
+     for (i = 0; i < number_of_tuples; i++){// stores each band in a hash table
+          printf("Clustering table %u/%u: %u %u-bit MinHash values for %u lists\r",
+                 i + 1, number_of_tuples, tuple_size, signatures->bits, listdb->size);
 
-          // cleaning list of used buckets
-          list_destroy(&hash_table.used_buckets);
+          if (mh_store_bbit_signatures(signatures, listdb, i, &hash_table, indices) != LSH_OK){
+               fprintf(stderr,"Error: Could not store table %u\n", i + 1);
+               break;
+          }
+          mhlink_link_table(listdb, &clusters, &hash_table, indices, checked, clus_table,
+                            NULL, signatures, thres);
      }
-
+          
+     mh_destroy(&hash_table);
      free(indices);
      free(checked);
      free(clus_table);
 
-     return clusters;     listdb_delete_smallest(&clusters, min_cluster_size);
+     listdb_delete_smallest(&clusters, min_cluster_size);
      ListDB models = mhlink_make_model(listdb, &clusters);
      listdb_destroy(&clusters);
      
      return models;
 }
+
+/**
+ * @brief Single-link clustering based on Min-Hashing without weighting.
+ *
+ * @param listdb Database of lists to be hashed
+ * @param table_size Number of buckets in the hash table
+ * @param tuple_size Number of MinHash values per tuple
+ * @param sim Similarity function for adding list to a cluster
+ * @param thres Threshold for adding list to a cluster
+ *
+ * @return Clusters of IDs
+ */
+ListDB mhlink_cluster(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
+                      double (*sim)(List *, List *), double thres, uint min_cluster_size)
+{
+     return mhlink_cluster_scheme(listdb, tuple_size, number_of_tuples, table_size,
+                                  MH_HASHED, NULL, sim, thres, min_cluster_size, NULL);
+}
+
+/**
+ * @brief Single-link clustering based on Min-Hashing with weighting.
+ *
+ * @param listdb Database of lists to be hashed
+ * @param table_size Number of buckets in the hash table
+ * @param tuple_size Number of MinHash values per tuple
+ * @param sim Similarity function for adding list to a cluster
+ * @param thres Threshold for adding list to a cluster
+ */
+ListDB mhlink_cluster_weighted(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint table_size,
+                               double *weights, double (*sim)(List *, List *), double thres,
+                               uint min_cluster_size)
+{
+     return mhlink_cluster_scheme(listdb, tuple_size, number_of_tuples, table_size,
+                                  MH_HASHED, weights, sim, thres, min_cluster_size, NULL);
+}
@@ -0,0 +1,517 @@
+/**
+ * @file mhsorted.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Sorted MinHash indexes. Each table stores the band keys of all
+ *        the lists with their IDs in a single array sorted by key (LSD
+ *        radix sort), so a bucket is the run of pairs with the same key.
+ *        Buckets are found by interpolation search, which is fast since
+ *        band keys are uniformly distributed. Tables need no per-bucket
+ *        allocation, probing or load factor, and are written to and
+ *        memory-mapped from files as they are.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mt64.h"
+#include "mhsorted.h"
+#include "univhash.h"
+
+/**
+ * @brief Initializes a sorted index structure to zero
+ *
+ * @param index Sorted index structure
+ */
+void mhsorted_init(SortedIndexMH *index)
+{
+     index->number_of_tables = 0;
+     index->tuple_size = 0;
+     index->size = 0;
+     mh_init(&index->sketcher);
+     index->a = NULL;
+     index->keys = NULL;
+     index->ids = NULL;
+     index->mapping = NULL;
+     index->mapping_size = 0;
+}
+
+/**
+ * @brief Creates an empty sorted index of number_of_tables tables. A
+ *        single sketcher computes the number_of_tables * tuple_size MinHash
+ *        values of a list, and the key of band l is stored in table l.
+ *
+ * @param number_of_tables Number of tables
+ * @param tuple_size Number of MinHash values per band
+ * @param dim Size of the vocabulary
+ * @param scheme MinHash scheme (MH_PERMUTATIONS, MH_HASHED, MH_OPH or MH_WEIGHTED)
+ * @param weights Weight of each item (NULL for unit weights)
+ *
+ * @return Sorted index structure
+ */
+SortedIndexMH mhsorted_create(uint number_of_tables, uint tuple_size, uint dim, uint scheme,
+                              double *weights)
+{
+     uint i;
+     uint number_of_values = number_of_tables * tuple_size;
+     SortedIndexMH index;
+
+     mhsorted_init(&index);
+     index.number_of_tables = number_of_tables;
+     index.tuple_size = tuple_size;
+     index.sketcher = mh_create_scheme(0, number_of_values, dim, scheme);
+     index.sketcher.weights = weights;
+     mh_generate_functions(&index.sketcher);
+
+     // generates array of random values for universal hashing of the bands
+     index.a = (ullong *) malloc(number_of_values * sizeof(ullong));
+     for (i = 0; i < number_of_values; i++)
+          index.a[i] = univhash_coefficient(genrand64_int64());
+
+     return index;
+}
+
+/**
+ * @brief Frees the tables of a sorted index (or unmaps them)
+ *
+ * @param index Sorted index structure
+ */
+static void mhsorted_free_tables(SortedIndexMH *index)
+{
+     if (index->mapping != NULL){
+          munmap(index->mapping, index->mapping_size);
+     } else {
+          free(index->keys);
+          free(index->ids);
+     }
+     index->keys = NULL;
+     index->ids = NULL;
+     index->mapping = NULL;
+     index->mapping_size = 0;
+     index->size = 0;
+}
+
+/**
+ * @brief Destroys a sorted index structure
+ *
+ * @param index Sorted index structure
+ */
+void mhsorted_destroy(SortedIndexMH *index)
+{
+     mhsorted_free_tables(index);
+     mh_destroy(&index->sketcher);
+     free(index->a);
+     mhsorted_init(index);
+}
+
+/**
+ * @brief Sorts (key, ID) pairs by key with an LSD radix sort of
+ *        MHSORTED_RADIX_BITS bits per pass. The digits of all passes are
+ *        counted in a single read of the keys, and passes where all the
+ *        keys have the same digit are skipped. The sort is stable.
+ *
+ * @param keys Keys (61-bit)
+ * @param ids IDs of the keys
+ * @param tmp_keys Scratch space for size keys
+ * @param tmp_ids Scratch space for size IDs
+ * @param size Number of pairs
+ */
+void mhsorted_radix_sort(ullong *keys, uint *ids, ullong *tmp_keys, uint *tmp_ids, uint size)
+{
+     uint i, pass;
+     uint mask = (1U << MHSORTED_RADIX_BITS) - 1;
+     uint counts[MHSORTED_RADIX_PASSES][1 << MHSORTED_RADIX_BITS];
+     ullong *src_keys = keys, *dst_keys = tmp_keys;
+     uint *src_ids = ids, *dst_ids = tmp_ids;
+
+     if (size < 2)
+          return;
+
+     memset(counts, 0, sizeof(counts));
+     for (i = 0; i < size; i++)
+          for (pass = 0; pass < MHSORTED_RADIX_PASSES; pass++)
+               counts[pass][(keys[i] >> (pass * MHSORTED_RADIX_BITS)) & mask]++;
+
+     for (pass = 0; pass < MHSORTED_RADIX_PASSES; pass++){
+          uint shift = pass * MHSORTED_RADIX_BITS;
+          uint *count = counts[pass];
+          uint digit, sum = 0;
+
+          if (count[(src_keys[0] >> shift) & mask] == size) // all keys have the same digit
+               continue;
+
+          // positions where each digit starts
+          for (digit = 0; digit <= mask; digit++){
+               uint c = count[digit];
+               count[digit] = sum;
+               sum += c;
+          }
+
+          for (i = 0; i < size; i++){
+               uint position = count[(src_keys[i] >> shift) & mask]++;
+               dst_keys[position] = src_keys[i];
+               dst_ids[position] = src_ids[i];
+          }
+
+          ullong *swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;
+          uint *swap_ids = src_ids; src_ids = dst_ids; dst_ids = swap_ids;
+     }
+
+     if (src_keys != keys){
+          memcpy(keys, src_keys, size * sizeof(ullong));
+          memcpy(ids, src_ids, size * sizeof(uint));
+     }
+}
+
+/**
+ * @brief Builds the tables of a sorted index from a database of lists,
+ *        replacing its previous content. Each list is sketched once, the
+ *        keys of its bands are written to all the tables, and the tables
+ *        are then sorted. Empty lists are not stored.
+ *
+ * @param index Sorted index structure
+ * @param listdb Database of lists
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (the index is memory-mapped)
+ */
+int mhsorted_build(SortedIndexMH *index, ListDB *listdb)
+{
+     uint i, j, size = 0, position = 0;
+     
+     if (index->mapping != NULL){
+          fprintf(stderr,"Error: Memory-mapped sorted indexes are read-only\n");
+          return LSH_INVALID;
+     }
+
+     mhsorted_free_tables(index);
+     for (i = 0; i < listdb->size; i++)
+          if (listdb->lists[i].size > 0)
+               size++;
+
+     size_t number_of_pairs = (size_t) index->number_of_tables * size;
+     ullong *minhashes = (ullong *) malloc(index->sketcher.tuple_size * sizeof(ullong));
+     ullong *hashes = (ullong *) malloc(index->number_of_tables * sizeof(ullong));
+     ullong *tmp_keys = (ullong *) malloc(size * sizeof(ullong));
+     uint *tmp_ids = (uint *) malloc(size * sizeof(uint));
+     index->keys = (ullong *) malloc(number_of_pairs * sizeof(ullong));
+     index->ids = (uint *) malloc(number_of_pairs * sizeof(uint));
+     if (minhashes == NULL || hashes == NULL || tmp_keys == NULL || tmp_ids == NULL ||
+         index->keys == NULL || index->ids == NULL){
+          free(minhashes);
+          free(hashes);
+          free(tmp_keys);
+          free(tmp_ids);
+          mhsorted_free_tables(index);
+          return LSH_NO_MEMORY;
+     }
+     index->size = size;
+
+     // sketches each list once and writes the keys of its bands
+     for (i = 0; i < listdb->size; i++){
+          if (listdb->lists[i].size == 0)
+               continue;
+
+          mh_compute_tuple(&listdb->lists[i], &index->sketcher, minhashes);
+          univhash_bands(minhashes, index->a, index->tuple_size, index->number_of_tables, hashes);
+          for (j = 0; j < index->number_of_tables; j++){
+               index->keys[(size_t) j * size + position] = hashes[j];
+               index->ids[(size_t) j * size + position] = i;
+          }
+          position++;
+     }
+
+     for (j = 0; j < index->number_of_tables; j++)
+          mhsorted_radix_sort(&index->keys[(size_t) j * size], &index->ids[(size_t) j * size],
+                              tmp_keys, tmp_ids, size);
+
+     free(minhashes);
+     free(hashes);
+     free(tmp_keys);
+     free(tmp_ids);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Finds the first position of a sorted array of keys whose key is
+ *        not less than a given key. The first steps interpolate the
+ *        position from the keys at the ends of the range (keys are uniform,
+ *        so few steps are needed), then the search continues by bisection
+ *        and finishes linearly on small ranges.
+ *
+ * @param keys Sorted keys
+ * @param size Number of keys
+ * @param key Key to be searched
+ *
+ * @return Position of the key, or of the next larger key (size if none)
+ */
+uint mhsorted_search(ullong *keys, uint size, ullong key)
+{
+     uint low = 0, high = size, step = 0;
+
+     // keys[low - 1] < key <= keys[high]
+     while (high - low > MHSORTED_LINEAR_SEARCH){
+          uint middle;
+          ullong low_key = keys[low], high_key = keys[high - 1];
+
+          if (key <= low_key)
+               return low;
+          if (key > high_key)
+               return high;
+
+          if (step++ < MHSORTED_INTERPOLATION_STEPS){ // interpolation
+               double fraction = (double) (key - low_key) / (double) (high_key - low_key);
+               middle = low + (uint) (fraction * (high - 1 - low));
+               if (middle >= high)
+                    middle = high - 1;
+          } else {
+               middle = low + (high - low) / 2;
+          }
+
+          if (keys[middle] < key)
+               low = middle + 1;
+          else
+               high = middle;
+     }
+
+     while (low < high && keys[low] < key)
+          low++;
+
+     return low;
+}
+
+/**
+ * @brief Retrieves the IDs stored in a sorted index that collide with a
+ *        list in at least one table
+ *
+ * @param index Sorted index structure
+ * @param query List to be queried
+ *
+ * @return Sorted list of candidate IDs, whose frequencies are the numbers
+ *         of tables where they collide with the query
+ */
+List mhsorted_query(SortedIndexMH *index, List *query)
+{
+     uint i, j;
+     ullong *minhashes = (ullong *) malloc(index->sketcher.tuple_size * sizeof(ullong));
+     ullong *hashes = (ullong *) malloc(index->number_of_tables * sizeof(ullong));
+     uint *starts = (uint *) malloc(index->number_of_tables * sizeof(uint));
+     uint *ends = (uint *) malloc(index->number_of_tables * sizeof(uint));
+     size_t number_of_candidates = 0;
+     List candidates;
+
+     list_init(&candidates);
+     if (query->size == 0 || index->size == 0 || minhashes == NULL || hashes == NULL ||
+         starts == NULL || ends == NULL){
+          free(minhashes);
+          free(hashes);
+          free(starts);
+          free(ends);
+          return candidates;
+     }
+
+     // finds the run of the key of each band
+     mh_compute_tuple(query, &index->sketcher, minhashes);
+     univhash_bands(minhashes, index->a, index->tuple_size, index->number_of_tables, hashes);
+     for (i = 0; i < index->number_of_tables; i++){
+          ullong *keys = &index->keys[(size_t) i * index->size];
+          starts[i] = ends[i] = mhsorted_search(keys, index->size, hashes[i]);
+          while (ends[i] < index->size && keys[ends[i]] == hashes[i])
+               ends[i]++;
+          number_of_candidates += ends[i] - starts[i];
+     }
+
+     // merges the runs and removes repeated IDs
+     candidates.data = (Item *) malloc(number_of_candidates * sizeof(Item));
+     if (candidates.data != NULL){
+          for (i = 0; i < index->number_of_tables; i++){
+               uint *ids = &index->ids[(size_t) i * index->size];
+               for (j = starts[i]; j < ends[i]; j++){
+                    Item new_item = {ids[j], 1};
+                    candidates.data[candidates.size++] = new_item;
+               }
+          }
+          list_sort_by_item(&candidates);
+          list_unique(&candidates);
+     }
+
+     free(minhashes);
+     free(hashes);
+     free(starts);
+     free(ends);
+
+     return candidates;
+}
+
+/**
+ * @brief Size in bytes of the MinHash functions of a sketcher
+ */
+static size_t mhsorted_functions_size(HashTableMH *sketcher)
+{
+     if (sketcher->scheme == MH_PERMUTATIONS)
+          return (size_t) sketcher->tuple_size * sketcher->dim * sizeof(RandomValue);
+
+     return (size_t) sketcher->tuple_size * sizeof(ullong);
+}
+
+/**
+ * @brief Saves a sorted index to a binary file. The file holds a
+ *        versioned header, the coefficients of the band keys, the MinHash
+ *        functions of the sketcher, and the keys and IDs of the tables.
+ *        Weights are not saved, but the header records whether the
+ *        sketcher had them so that mhsorted_load can ask for them.
+ *
+ * @param filename Name of the file
+ * @param index Sorted index structure
+ *
+ * @return 0 on success, -1 if the file could not be written
+ */
+int mhsorted_save(char *filename, SortedIndexMH *index)
+{
+     FILE *file;
+     SortedIndexFileHeader header;
+     size_t number_of_values = (size_t) index->number_of_tables * index->tuple_size;
+     size_t number_of_pairs = (size_t) index->number_of_tables * index->size;
+     void *functions = index->sketcher.scheme == MH_PERMUTATIONS ?
+          (void *) index->sketcher.permutations : (void *) index->sketcher.seeds;
+
+     if (!(file = fopen(filename,"wb"))) {
+          fprintf(stderr,"Error: Could not create file %s\n", filename);
+          return -1;
+     }
+
+     memset(&header, 0, sizeof(SortedIndexFileHeader));
+     strncpy(header.magic, MHSORTED_MAGIC, sizeof(header.magic));
+     header.version = MHSORTED_VERSION;
+     header.scheme = index->sketcher.scheme;
+     header.number_of_tables = index->number_of_tables;
+     header.tuple_size = index->tuple_size;
+     header.dim = index->sketcher.dim;
+     header.size = index->size;
+     header.weighted = index->sketcher.weights != NULL;
+
+     if (fwrite(&header, sizeof(SortedIndexFileHeader), 1, file) != 1 ||
+         fwrite(index->a, sizeof(ullong), number_of_values, file) != number_of_values ||
+         fwrite(functions, 1, mhsorted_functions_size(&index->sketcher), file) !=
+         mhsorted_functions_size(&index->sketcher) ||
+         fwrite(index->keys, sizeof(ullong), number_of_pairs, file) != number_of_pairs ||
+         fwrite(index->ids, sizeof(uint), number_of_pairs, file) != number_of_pairs) {
+          fprintf(stderr,"Error: Could not write file %s\n", filename);
+          fclose(file);
+          return -1;
+     }
+
+     if (fclose(file)) {
+          fprintf(stderr,"Error: Could not close file %s\n", filename);
+          return -1;
+     }
+
+     return 0;
+}
+
+/**
+ * @brief Loads a sorted index saved with mhsorted_save. The keys and IDs
+ *        of the tables are memory-mapped, so loading does not read them;
+ *        the coefficients and MinHash functions are copied. Weights are
+ *        not saved, so an index built with weights must be given the same
+ *        weights and one built without them must not be given any. If
+ *        the file is not a valid sorted index, the weights do not match or
+ *        there is not enough memory, an empty index is returned.
+ *
+ * @param filename Name of the file
+ * @param weights Weight of each item used to build the index (NULL for unit weights)
+ *
+ * @return Sorted index structure
+ */
+SortedIndexMH mhsorted_load(char *filename, double *weights)
+{
+     int fd;
+     struct stat st;
+     void *mapping;
+     SortedIndexFileHeader *header;
+     SortedIndexMH index;
+
+     mhsorted_init(&index);
+     if ((fd = open(filename, O_RDONLY)) < 0)
+          return index;
+
+     if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(SortedIndexFileHeader)) {
+          close(fd);
+          return index;
+     }
+
+     mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+     close(fd);
+     if (mapping == MAP_FAILED)
+          return index;
+
+     // checks version and size of the file
+     header = (SortedIndexFileHeader *) mapping;
+     size_t number_of_values = (size_t) header->number_of_tables * header->tuple_size;
+     size_t number_of_pairs = (size_t) header->number_of_tables * header->size;
+     size_t functions_size = header->scheme == MH_PERMUTATIONS ?
+          number_of_values * header->dim * sizeof(RandomValue) : number_of_values * sizeof(ullong);
+     if (strncmp(header->magic, MHSORTED_MAGIC, sizeof(header->magic)) != 0 ||
+         header->version != MHSORTED_VERSION ||
+         header->scheme > MH_WEIGHTED ||
+         (size_t) st.st_size != sizeof(SortedIndexFileHeader) + number_of_values * sizeof(ullong) +
+         functions_size + number_of_pairs * (sizeof(ullong) + sizeof(uint))) {
+          munmap(mapping, st.st_size);
+          return index;
+     }
+
+     // weights are not saved, so queries need the ones used to build the index
+     if (header->weighted && weights == NULL) {
+          fprintf(stderr,"Error: Index %s was built with weights, which must be given to load it\n", filename);
+          munmap(mapping, st.st_size);
+          return index;
+     }
+     if (!header->weighted && weights != NULL) {
+          fprintf(stderr,"Error: Index %s was built without weights\n", filename);
+          munmap(mapping, st.st_size);
+          return index;
+     }
+
+     char *data = (char *) mapping + sizeof(SortedIndexFileHeader);
+     index.sketcher = mh_create_scheme(0, (uint) number_of_values, header->dim, header->scheme);
+     index.sketcher.weights = weights;
+     index.a = (ullong *) malloc(number_of_values * sizeof(ullong));
+     void *functions = header->scheme == MH_PERMUTATIONS ?
+          (void *) index.sketcher.permutations : (void *) index.sketcher.seeds;
+     if (number_of_values > 0 && (index.a == NULL || index.sketcher.a == NULL || functions == NULL)) {
+          fprintf(stderr,"Error: Not enough memory to load index %s\n", filename);
+          munmap(mapping, st.st_size);
+          mhsorted_destroy(&index);
+          return index;
+     }
+
+     index.number_of_tables = header->number_of_tables;
+     index.tuple_size = header->tuple_size;
+     index.size = header->size;
+     memcpy(index.a, data, number_of_values * sizeof(ullong));
+     data += number_of_values * sizeof(ullong);
+     memcpy(functions, data, functions_size);
+     data += functions_size;
+     index.keys = (ullong *) data;
+     index.ids = (uint *) (data + number_of_pairs * sizeof(ullong));
+     index.mapping = mapping;
+     index.mapping_size = st.st_size;
+
+     return index;
+}
@@ -25,8 +25,18 @@
 #include <time.h>
 #include <math.h>
 #include <inttypes.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "mt64.h"
 #include "minhash.h"
+#include "minhash_simd.h"
+#include "univhash.h"
+#include "bucketdir.h"
+#include "arena.h"
+#include "parallel.h"
 
 /**
  * @Brief Prints head of a hash table structure
@@ -39,21 +49,23 @@ void mh_print_head(HashTableMH *hash_table)
 
      printf("========== Hash table =========\n");
      printf("Table size: %d\n"
+            "Number of buckets: %d\n"
             "Tuple size: %d\n"
             "Dimensionality: %d\n"
+            "Scheme: %s\n"
             "Used buckets: ",
             hash_table->table_size, 
+            hash_table->number_of_buckets,
             hash_table->tuple_size,
-            hash_table->dim); 
+            hash_table->dim,
+            hash_table->scheme == MH_WEIGHTED ? "weighted" :
+            hash_table->scheme == MH_OPH ? "one permutation" :
+            hash_table->scheme == MH_HASHED ? "hashed" : "permutations"); 
      list_print(&hash_table->used_buckets);
 
      printf("a: ");
      for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->a[i]);
-
-     printf("\nb: ");
-     for (i = 0; i < hash_table->tuple_size; i++)
-          printf("%u ", hash_table->b[i]);
+          printf("%llu ", hash_table->a[i]);
      printf("\n");
 }
 
@@ -83,11 +95,22 @@ void mh_init(HashTableMH *hash_table)
      hash_table->table_size = 0;
      hash_table->tuple_size = 0; 
      hash_table->dim = 0; 
+     hash_table->scheme = MH_PERMUTATIONS; 
      hash_table->permutations  = NULL; 
+     hash_table->seeds  = NULL; 
      hash_table->buckets = NULL;
      list_init(&hash_table->used_buckets);
+     hash_table->storage = NULL;
+     arena_init(&hash_table->arena);
+     bucketdir_init(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
      hash_table->a = NULL;
-     hash_table->b = NULL;
+     hash_table->weights = NULL;
+     hash_table->max_bucket_size = 0;
+     hash_table->bucket_policy = MH_BUCKET_KEEP;
+     memset(hash_table->split_seeds, 0, sizeof(hash_table->split_seeds));
+     memset(hash_table->split_a, 0, sizeof(hash_table->split_a));
+     list_init(&hash_table->overflowed);
 }
 
 /**
@@ -102,32 +125,60 @@ void mh_rng_init(unsigned long long seed)
  * @brief Creates a hash table structure for performing Min-Hash
  *        on a collection of list.
  *
- * @param Number of MinHash values per tuple
- * @param dim Largest item value in the database of lists
  * @param table_size Number of buckets in the hash table
+ * @param tuple_size Number of MinHash values per tuple
+ * @param dim Largest item value in the database of lists
  *
  * @return Hash table structure
  */
 HashTableMH mh_create(uint table_size, uint tuple_size, uint dim)
+{
+     return mh_create_scheme(table_size, tuple_size, dim, MH_PERMUTATIONS);
+}
+
+/**
+ * @brief Creates a hash table structure for performing Min-Hash
+ *        on a collection of list with a given scheme for generating
+ *        the random values of the items. MH_PERMUTATIONS stores a
+ *        random value for each item and MinHash function, whereas
+ *        MH_HASHED only stores a seed for each MinHash function and
+ *        computes the random values on demand, so its memory does
+ *        not depend on dim. MH_OPH computes all the MinHash values from
+ *        a single hashed permutation (one permutation hashing) and
+ *        MH_WEIGHTED performs consistent weighted sampling on the item
+ *        frequencies.
+ *
+ * @param table_size Initial number of buckets in the hash table (it grows as needed)
+ * @param tuple_size Number of MinHash values per tuple
+ * @param dim Largest item value in the database of lists
+ * @param scheme Scheme for generating the random values (MH_PERMUTATIONS,
+ *        MH_HASHED, MH_OPH or MH_WEIGHTED)
+ *
+ * @return Hash table structure
+ */
+HashTableMH mh_create_scheme(uint table_size, uint tuple_size, uint dim, uint scheme)
 {
      uint i;
      HashTableMH hash_table;
 
+     mh_init(&hash_table);
      hash_table.table_size = table_size;
      hash_table.tuple_size = tuple_size; 
      hash_table.dim = dim; 
-     hash_table.permutations = (RandomValue *) malloc(tuple_size * dim * sizeof(RandomValue)); 
+     hash_table.scheme = scheme; 
+     if (scheme == MH_PERMUTATIONS)
+          hash_table.permutations = (RandomValue *) malloc((size_t) tuple_size * dim * sizeof(RandomValue)); 
+     else
+          hash_table.seeds = (ullong *) malloc(tuple_size * sizeof(ullong)); 
     
      hash_table.buckets = (BucketMH *) calloc(table_size, sizeof(BucketMH));
-     list_init(&hash_table.used_buckets);
+     hash_table.directory = bucketdir_create(table_size);
 
      // generates array of random values for universal hashing
-     hash_table.a = (uint *) malloc(tuple_size * sizeof(uint));
-     hash_table.b = (uint *) malloc(tuple_size * sizeof(uint));
-     for (i = 0; i < tuple_size; i++){
-          hash_table.a[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-          hash_table.b[i] = (unsigned int) (genrand64_int64() & 0xFFFFFFFF);
-     }
+     hash_table.a = (ullong *) malloc(tuple_size * sizeof(ullong));
+     if (hash_table.a != NULL)
+          for (i = 0; i < tuple_size; i++)
+               hash_table.a[i] = univhash_coefficient(genrand64_int64());
      
      return hash_table;
 }
@@ -140,55 +191,29 @@ HashTableMH mh_create(uint table_size, uint tuple_size, uint dim)
  */
 void mh_erase_from_list(List *list, HashTableMH *hash_table)
 {  
-     uint index = mh_get_index(list, hash_table);
-     list_destroy(&hash_table->buckets[index].items);
-     hash_table->buckets[index].hash_value = 0;
-     
-     Item item = {index, 1};
-     Item *ptr = list_find(&hash_table->used_buckets, item);
-     uint position = (uint) (ptr - hash_table->used_buckets.data);
-     list_delete_position(&hash_table->used_buckets, position);
-}
-
-/**
- * @brief Removes items in a given bucket of the hash table
- *
- * @param index Index of the bucket to be removed
- * @param hash_table Hash table structure
- */
-void mh_erase_from_index(uint index, HashTableMH *hash_table)
-{  
-     if (index >= 0 && index < hash_table->table_size){
-          // destroy bucket
-          list_destroy(&hash_table->buckets[index].items);
-          hash_table->buckets[index].hash_value = 0;
-
-          // delete bucket index from list of used buckets
-          Item item = {index, 1};
-          Item *ptr = list_find(&hash_table->used_buckets, item);
-          uint position = (uint) (ptr - hash_table->used_buckets.data);
-          list_delete_position(&hash_table->used_buckets, position);
-     } else {
-          printf("Index %u out of range! Table size is %u", index, hash_table->table_size);
-     }
+     uint index = bucketdir_find(&hash_table->directory, mh_univhash(list, hash_table));
+     if (index != LSH_NO_INDEX)
+          mh_erase_from_index(index, hash_table);
 }
 
 /**
- * @brief Removes the items in all the used buckets of the hash table
+ * @brief Removes the items in all the used buckets of the hash table.
+ *        The IDs are released at once by rewinding the arena, and the
+ *        bucket directory is emptied in time proportional to its capacity.
  *
  * @param hash_table Hash table structure
  */
 void mh_clear_table(HashTableMH *hash_table)
 {  
-     uint i;
-
-     // empties used buckets of a hash table
-     for (i = 0; i < hash_table->used_buckets.size; i++) {
-          list_destroy(&hash_table->buckets[hash_table->used_buckets.data[i].item].items);
-          hash_table->buckets[hash_table->used_buckets.data[i].item].hash_value = 0;
-     }
-
+     // releases the IDs of all the buckets at once
+     arena_rewind(&hash_table->arena);
+     hash_table->storage = NULL;
      list_destroy(&hash_table->used_buckets);
+     list_destroy(&hash_table->overflowed);
+
+     // buckets are kept allocated for the next tuples
+     bucketdir_clear(&hash_table->directory);
+     hash_table->number_of_buckets = 0;
 }
 
 /**
@@ -199,17 +224,22 @@ void mh_clear_table(HashTableMH *hash_table)
 void mh_destroy(HashTableMH *hash_table)
 {
      free(hash_table->permutations);
+     free(hash_table->seeds);
      free(hash_table->buckets);
+     arena_destroy(&hash_table->arena);
+     bucketdir_destroy(&hash_table->directory);
      free(hash_table->a);
-     free(hash_table->b);
      list_destroy(&hash_table->used_buckets);
+     list_destroy(&hash_table->overflowed);
      mh_init(hash_table);
 }
 
 /**
  * @brief Assigns, for each MinHash function, a random positive integer 
  *        and a uniformly distributed U(0,1) number to each possible 
- *        item in the database of lists.
+ *        item in the database of lists. Random values are stored in
+ *        item-major order, i.e. the values of all the MinHash functions
+ *        for a given item are contiguous in memory.
  * 
  * @param dim Largest item value in the database of lists
  * @param tuple_size Number of MinHash values per tuple
@@ -221,12 +251,12 @@ void mh_generate_permutations(uint dim, uint tuple_size, RandomValue *permutatio
      ullong rnd;
 
      // generates random permutations by assigning a random value to each item
-     // of the universal set
+     // of the universal set (same drawing order as the function-major layout)
      for (i = 0; i < tuple_size; i++){ 
           for (j = 0; j < dim; j++){
                rnd = genrand64_int64();
-               permutations[i * dim + j].random_int = rnd;
-               permutations[i * dim + j].random_double = -logl((rnd >> 11) * (1.0/9007199254740991.0));
+               permutations[(size_t) j * tuple_size + i].random_int = rnd;
+               permutations[(size_t) j * tuple_size + i].random_double = -logl((rnd >> 11) * (1.0/9007199254740991.0));
           }
      }
 }
@@ -244,33 +274,120 @@ void mh_weight_permutations(uint dim, uint tuple_size, RandomValue *permutations
      uint i, j;
 
      // weights the assigned random value of each item
+     for (j = 0; j < dim; j++)
+          for (i = 0; i < tuple_size; i++)
+               permutations[(size_t) j * tuple_size + i].random_double /= weights[j];
+}
+
+/**
+ * @brief Draws a random seed for each MinHash function of the MH_HASHED scheme.
+ * 
+ * @param tuple_size Number of MinHash values per tuple
+ * @param seeds Seeds of the MinHash functions
+ */
+void mh_generate_seeds(uint tuple_size, ullong *seeds)
+{
+     uint i;
+
      for (i = 0; i < tuple_size; i++)
-          for (j = 0; j < dim; j++)
-               permutations[i * dim + j].random_double /= weights[j];
+          seeds[i] = genrand64_int64();
 }
 
 /**
- * @brief Assigns, for each MinHash function, a random positive integer 
- *        and a uniformly distributed U(0,1) number to each possible 
- *        item in the database of lists.
+ * @brief Draws a new set of MinHash functions for a hash table. For the
+ *        MH_PERMUTATIONS scheme the random values of all the items are
+ *        regenerated (and weighted if the table has weights), whereas for
+ *        the other schemes only new seeds are drawn.
+ * 
+ * @param hash_table Hash table structure
+ */
+void mh_generate_functions(HashTableMH *hash_table)
+{
+     if (hash_table->scheme == MH_PERMUTATIONS){
+          mh_generate_permutations(hash_table->dim, hash_table->tuple_size, hash_table->permutations);
+          if (hash_table->weights != NULL)
+               mh_weight_permutations(hash_table->dim, hash_table->tuple_size,
+                                      hash_table->permutations, hash_table->weights);
+     } else {
+          mh_generate_seeds(hash_table->tuple_size, hash_table->seeds);
+     }
+}
+
+/**
+ * @brief Mixes the bits of a 64-bit integer (SplitMix64 finalizer).
+ * 
+ * @param x Integer to be mixed
+ *
+ * @return Mixed integer
+ */
+ullong mh_mix64(ullong x)
+{
+     x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+     x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+     return x ^ (x >> 31);
+}
+
+/**
+ * @brief Computes the random value assigned to an item by a MinHash
+ *        function of the MH_HASHED scheme.
+ * 
+ * @param seed Seed of the MinHash function
+ * @param item Item
+ *
+ * @return 64-bit random value of the item
+ */
+ullong mh_hash_item(ullong seed, uint item)
+{
+     return mh_mix64(seed + ((ullong) item + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+ * @brief Maps the random value of an item with a given weight to a key
+ *        that is minimized by MinHash. A random value h is taken as an
+ *        exponential variable -log(1 - h/2^64) divided by the weight and
+ *        mapped back to the 64-bit domain, so that items with unit weight
+ *        keep their random value as key.
+ * 
+ * @param hash Random value of the item
+ * @param weight Weight of the item
+ *
+ * @return Key of the item
+ */
+ullong mh_weighted_key(ullong hash, double weight)
+{
+     double u = (hash >> 11) * (1.0 / 9007199254740992.0);
+     double v = -expm1(log1p(-u) / weight);
+
+     if (v >= 1.0) // zero weight or overflow
+          return LARGEST_INT64;
+
+     return ((ullong) (v * 9007199254740992.0)) << 11;
+}
+
+/**
+ * @brief Computes the MinHash value of a list for a single MinHash function.
  * 
  * @param list List to be hashed
+ * @param permutations Random values in item-major order
+ * @param tuple_size Number of MinHash functions in the permutations array
  * @param pernum Number of the permutation
- * @param permutations Random permutations
- * @param dim Dimensionality of the data (number of lists)
+ *
+ * @return MinHash value
  */
-ullong mh_compute_minhash(List *list, RandomValue *permutations)
+ullong mh_compute_minhash(List *list, RandomValue *permutations, uint tuple_size, uint pernum)
 {
      uint i;
 
      // get randomly assigned values for list
      // and find minimum value
-     ullong min_int = permutations[list->data[0].item].random_int;
-     double min_double = permutations[list->data[0].item].random_double / (double) list->data[0].freq;
+     RandomValue *rv = &permutations[(size_t) list->data[0].item * tuple_size + pernum];
+     ullong min_int = rv->random_int;
+     double min_double = rv->random_double / (double) list->data[0].freq;
      for (i = 1; i < list->size; i++){
-          double current_value = permutations[list->data[i].item].random_double / (double) list->data[i].freq;
+          rv = &permutations[(size_t) list->data[i].item * tuple_size + pernum];
+          double current_value = rv->random_double / (double) list->data[i].freq;
           if (min_double > current_value){
-               min_int = permutations[list->data[i].item].random_int;
+               min_int = rv->random_int;
                min_double = current_value;
           }
      }
@@ -279,96 +396,354 @@ ullong mh_compute_minhash(List *list, RandomValue *permutations)
 }
 
 /**
- * @brief Universal hashing for getting a hash table index from the corresponding minhash tuple
- *
+ * @brief Computes the MinHash values of a list for all the MinHash functions
+ *        at once. The list is traversed a single time and, for each item, the
+ *        random values of every MinHash function are read from one contiguous
+ *        block of the item-major permutations array. Values are divided by
+ *        the frequency of the item as in mh_compute_minhash, so both give
+ *        the same MinHash values.
+ * 
  * @param list List to be hashed
- * @param hash_table Hash table structure
- * @param hash_value Hash value
- * @param index Table index
+ * @param permutations Random values in item-major order
+ * @param tuple_size Number of MinHash functions
+ * @param minhashes Array where the tuple_size MinHash values are stored
  */
-void mh_univhash(List *list, HashTableMH *hash_table, uint *hash_value, uint *index)
+void mh_compute_minhashes(List *list, RandomValue *permutations, uint tuple_size, ullong *minhashes)
 {
-     uint i;
-     ullong minhash;
-     __uint128_t temp_index = 0;
-     __uint128_t temp_hv = 0;
+     uint i, j;
+     double stack_values[MH_STACK_TUPLE_SIZE];
+     double *min_values = stack_values;
+
+     if (tuple_size > MH_STACK_TUPLE_SIZE)
+          min_values = (double *) malloc(tuple_size * sizeof(double));
+
+     // without memory for the minima each function is computed on its own
+     if (min_values == NULL){
+          for (j = 0; j < tuple_size; j++)
+               minhashes[j] = mh_compute_minhash(list, permutations, tuple_size, j);
+          return;
+     }
 
-     // computes MinHash values
-     for (i = 0; i < hash_table->tuple_size; i++){
-          minhash = mh_compute_minhash(list, &hash_table->permutations[i * hash_table->dim]);
-          temp_index += ((ullong) hash_table->a[i]) * minhash;
-          temp_hv += ((ullong) hash_table->b[i]) * minhash; 
+     // initializes minima with the first item of the list
+     RandomValue *rv = &permutations[(size_t) list->data[0].item * tuple_size];
+     double freq = (double) list->data[0].freq;
+     for (j = 0; j < tuple_size; j++){
+          minhashes[j] = rv[j].random_int;
+          min_values[j] = rv[j].random_double / freq;
+     }
+
+     // updates all the minima with each remaining item
+     for (i = 1; i < list->size; i++){
+          rv = &permutations[(size_t) list->data[i].item * tuple_size];
+          freq = (double) list->data[i].freq;
+          for (j = 0; j < tuple_size; j++){
+               double current_value = rv[j].random_double / freq;
+               if (min_values[j] > current_value){
+                    minhashes[j] = rv[j].random_int;
+                    min_values[j] = current_value;
+               }
+          }
      }
 
-     // computes 2nd-level hash value and index (universal hash functions)
-     *hash_value = (temp_hv % LARGEST_PRIME64);   
-     *index = (temp_index % LARGEST_PRIME64) % hash_table->table_size;
+     if (min_values != stack_values)
+          free(min_values);
 }
 
 /**
- * @brief Computes 2nd-level hash value of lists using open 
- *        adressing collision resolution and linear probing.
- * @todo Add other probing strategies.
- *
+ * @brief Computes the MinHash values of a list for all the MinHash functions
+ *        of the MH_HASHED scheme in a single pass over the list. The random
+ *        value of each item is computed on demand from the seed of each
+ *        function, and the MinHash value is the minimum key in the list.
+ * 
  * @param list List to be hashed
- * @param hash_table Hash table structure
- *
- * @return - index of the hash table
- */ 
-uint mh_get_index(List *list, HashTableMH *hash_table)
+ * @param seeds Seeds of the MinHash functions
+ * @param weights Weight of each item (NULL for unit weights)
+ * @param tuple_size Number of MinHash functions
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_compute_hashed_minhashes(List *list, ullong *seeds, double *weights, uint tuple_size,
+                                 ullong *minhashes)
 {
-     uint checked_buckets, index, hash_value;
-     
-     mh_univhash(list, hash_table, &hash_value, &index);
-     if (hash_table->buckets[index].items.size != 0){ // examine buckets (open adressing)
-          if (hash_table->buckets[index].hash_value != hash_value){
-               checked_buckets = 1;
-               while (checked_buckets < hash_table->table_size){ // linear probing
-                    index = ((index + 1) & (hash_table->table_size - 1));
-                    if (hash_table->buckets[index].items.size != 0){
-                         if (hash_table->buckets[index].hash_value == hash_value)
-                              break;   
-                    } else {
-                         hash_table->buckets[index].hash_value = hash_value; 
+     uint i, j;
+
+     for (j = 0; j < tuple_size; j++)
+          minhashes[j] = LARGEST_INT64;
+
+     for (i = 0; i < list->size; i++){
+          uint item = list->data[i].item;
+          double weight = (double) list->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+
+          if (weight == 1.0){
+               for (j = 0; j < tuple_size; j++){
+                    ullong key = mh_hash_item(seeds[j], item);
+                    if (minhashes[j] > key)
+                         minhashes[j] = key;
+               }
+          } else {
+               for (j = 0; j < tuple_size; j++){
+                    ullong key = mh_weighted_key(mh_hash_item(seeds[j], item), weight);
+                    if (minhashes[j] > key)
+                         minhashes[j] = key;
+               }
+          }
+     }
+}
+
+/**
+ * @brief Computes the MinHash values of a list with one permutation hashing
+ *        (OPH) and optimal densification [Shrivastava, ICML 2017]. Items
+ *        are hashed once with a single function, the hashed space is split
+ *        into tuple_size bins and the minimum key of each bin is kept. Each
+ *        empty bin then takes the value of a non-empty bin chosen by
+ *        hashing the empty bin with an increasing attempt number, which
+ *        keeps the collision probability equal to the Jaccard similarity.
+ *        The cost is O(|list| + tuple_size) instead of O(|list| * tuple_size).
+ * 
+ * @param list List to be hashed
+ * @param seed Seed of the permutation
+ * @param weights Weight of each item (NULL for unit weights)
+ * @param tuple_size Number of bins (MinHash values)
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_compute_oph_minhashes(List *list, ullong seed, double *weights, uint tuple_size,
+                              ullong *minhashes)
+{
+     uint i, j, attempt;
+     uint nonempty_bins = 0;
+     uchar stack_filled[MH_STACK_TUPLE_SIZE];
+     uchar *filled = stack_filled;
+
+     if (tuple_size > MH_STACK_TUPLE_SIZE)
+          filled = (uchar *) malloc(tuple_size * sizeof(uchar));
+
+     for (j = 0; j < tuple_size; j++){
+          minhashes[j] = LARGEST_INT64;
+          filled[j] = 0;
+     }
+
+     // assigns each item to a bin and keeps the minimum key of each bin
+     for (i = 0; i < list->size; i++){
+          uint item = list->data[i].item;
+          double weight = (double) list->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+          
+          ullong hash = mh_hash_item(seed, item);
+          uint bin = (uint) (((__uint128_t) hash * tuple_size) >> 64);
+          ullong key = mh_mix64(hash);
+          if (weight != 1.0)
+               key = mh_weighted_key(key, weight);
+
+          if (!filled[bin]){
+               filled[bin] = 1;
+               nonempty_bins++;
+               minhashes[bin] = key;
+          } else if (minhashes[bin] > key){
+               minhashes[bin] = key;
+          }
+     }
+
+     // optimal densification: empty bins borrow from randomly probed non-empty bins
+     if (nonempty_bins > 0 && nonempty_bins < tuple_size){
+          ullong densification_seed = mh_mix64(seed ^ 0xD6E8FEB86659FD93ULL);
+          for (j = 0; j < tuple_size; j++){
+               if (filled[j])
+                    continue;
+               
+               for (attempt = 1; ; attempt++){
+                    ullong hash = mh_mix64(densification_seed + (((ullong) j << 32) | attempt));
+                    uint bin = (uint) (((__uint128_t) hash * tuple_size) >> 64);
+                    if (filled[bin] == 1){
+                         minhashes[j] = minhashes[bin];
                          break;
                     }
-                    checked_buckets++;      
                }
-               
-               if (checked_buckets == hash_table->table_size){
-                    fprintf(stderr,"Error: The hash table is full!\n ");
-                    exit(EXIT_FAILURE);
+               filled[j] = 2; // densified bins are not used as sources
+          }
+     }
+
+     if (filled != stack_filled)
+          free(filled);
+}
+
+/**
+ * @brief Computes weighted MinHash values of a list with Improved Consistent
+ *        Weighted Sampling (ICWS) [Ioffe, ICDM 2010]. The weight of each
+ *        item is its frequency (multiplied by its weight if given), so
+ *        lists with integer or real weights are hashed in time proportional
+ *        to their number of distinct items, without expanding them. The
+ *        probability of two lists having the same value is their weighted
+ *        Jaccard similarity. The random variables of each item are computed
+ *        on demand from the seed of each function.
+ * 
+ * @param list List to be hashed
+ * @param seeds Seeds of the MinHash functions
+ * @param weights Weight of each item (NULL for unit weights)
+ * @param tuple_size Number of MinHash functions
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_compute_icws_minhashes(List *list, ullong *seeds, double *weights, uint tuple_size,
+                               ullong *minhashes)
+{
+     uint i, j;
+     double stack_values[MH_STACK_TUPLE_SIZE];
+     double *min_values = stack_values;
+     const double scale = 1.0 / 9007199254740992.0;
+
+     if (tuple_size > MH_STACK_TUPLE_SIZE)
+          min_values = (double *) malloc(tuple_size * sizeof(double));
+
+     for (j = 0; j < tuple_size; j++){
+          minhashes[j] = LARGEST_INT64;
+          min_values[j] = INF;
+     }
+
+     for (i = 0; i < list->size; i++){
+          uint item = list->data[i].item;
+          double weight = (double) list->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+          if (weight <= 0.0)
+               continue;
+
+          double log_weight = log(weight);
+          for (j = 0; j < tuple_size; j++){
+               // draws r, c ~ Gamma(2, 1) and beta ~ U(0, 1) for the item
+               ullong h1 = mh_hash_item(seeds[j], item);
+               ullong h2 = mh_mix64(h1 + 0x9E3779B97F4A7C15ULL);
+               ullong h3 = mh_mix64(h2 + 0x9E3779B97F4A7C15ULL);
+               ullong h4 = mh_mix64(h3 + 0x9E3779B97F4A7C15ULL);
+               ullong h5 = mh_mix64(h4 + 0x9E3779B97F4A7C15ULL);
+               double r = -log((((h1 >> 11) + 1) * scale) * (((h2 >> 11) + 1) * scale));
+               double c = -log((((h3 >> 11) + 1) * scale) * (((h4 >> 11) + 1) * scale));
+               double beta = (h5 >> 11) * scale;
+
+               // computes log(a) = log(c) - r (t - beta + 1) to avoid exponentials
+               double t = floor(log_weight / r + beta);
+               double log_a = log(c) - r * (t - beta + 1.0);
+               if (log_a < min_values[j]){
+                    min_values[j] = log_a;
+                    minhashes[j] = mh_mix64(((ullong) item << 32) ^ (ullong) (uint) (int) t);
                }
           }
-     } else {
-          hash_table->buckets[index].hash_value = hash_value; 
      }
-     
-     return index;
+
+     if (min_values != stack_values)
+          free(min_values);
 }
 
 /**
- * @brief Stores lists in the hash table.
+ * @brief Computes the tuple of MinHash values of a list according to the
+ *        scheme of the hash table. The MH_PERMUTATIONS and MH_HASHED schemes
+ *        use the vectorized kernel selected for the CPU.
+ * 
+ * @param list List to be hashed
+ * @param hash_table Hash table structure
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_compute_tuple(List *list, HashTableMH *hash_table, ullong *minhashes)
+{
+     if (hash_table->scheme == MH_HASHED)
+          mh_simd_compute_hashed_minhashes(list, hash_table->seeds, hash_table->weights,
+                                           hash_table->tuple_size, minhashes);
+     else if (hash_table->scheme == MH_WEIGHTED)
+          mh_compute_icws_minhashes(list, hash_table->seeds, hash_table->weights,
+                                    hash_table->tuple_size, minhashes);
+     else if (hash_table->scheme == MH_OPH)
+          mh_compute_oph_minhashes(list, hash_table->seeds[0], hash_table->weights,
+                                   hash_table->tuple_size, minhashes);
+     else
+          mh_simd_compute_minhashes(list, hash_table->permutations, hash_table->tuple_size, minhashes);
+}
+
+/**
+ * @brief Universal hashing for getting the 2nd-level hash value of a tuple
+ *        of MinHash values, computed modulo the Mersenne prime 2^61 - 1.
+ *
+ * @param minhashes Tuple of tuple_size MinHash values
+ * @param hash_table Hash table structure
+ *
+ * @return 2nd-level hash value
+ */
+ullong mh_univhash_tuple(ullong *minhashes, HashTableMH *hash_table)
+{
+     return univhash_tuple(minhashes, hash_table->a, hash_table->tuple_size);
+}
+
+/**
+ * @brief Universal hashing for getting the 2nd-level hash value of the
+ *        MinHash tuple of a list
  *
  * @param list List to be hashed
+ * @param hash_table Hash table structure
+ *
+ * @return 2nd-level hash value
+ */
+ullong mh_univhash(List *list, HashTableMH *hash_table)
+{
+     ullong hash_value;
+     ullong stack_minhashes[MH_STACK_TUPLE_SIZE];
+     ullong *minhashes = stack_minhashes;
+
+     if (hash_table->tuple_size > MH_STACK_TUPLE_SIZE)
+          minhashes = (ullong *) malloc(hash_table->tuple_size * sizeof(ullong));
+
+     // computes MinHash values in a single pass over the list
+     mh_compute_tuple(list, hash_table, minhashes);
+     hash_value = mh_univhash_tuple(minhashes, hash_table);
+
+     if (minhashes != stack_minhashes)
+          free(minhashes);
+
+     return hash_value;
+}
+
+// bucket engine of the hash table (see lshtable.h)
+#define LSH_PREFIX mh
+#define LSH_TABLE HashTableMH
+#define LSH_BUCKET BucketMH
+#define LSH_INDEX HashIndexMH
+#define LSH_OBJECT List
+#define LSH_OBJECT_NAME list
+#define LSH_DB ListDB
+#define LSH_DB_NAME listdb
+#define LSH_DB_OBJECTS lists
+#define LSH_KEY(object, hash_table) mh_univhash(object, hash_table)
+#include "lshtable.h"
+
+/**
+ * @brief Computes the bucket of a tuple of MinHash values
+ *
+ * @param minhashes Tuple of tuple_size MinHash values
+ * @param hash_table Hash table structure
+ *
+ * @return - index of the hash table (LSH_NO_INDEX on failure)
+ */ 
+uint mh_get_tuple_index(ullong *minhashes, HashTableMH *hash_table)
+{
+     return mh_probe(hash_table, mh_univhash_tuple(minhashes, hash_table));
+}
+
+/**
+ * @brief Stores a tuple of MinHash values in the hash table.
+ *
+ * @param minhashes Tuple of tuple_size MinHash values
  * @param id ID of the list
  * @param hash_table Hash table
+ *
+ * @return Index of the bucket, LSH_NO_INDEX if the tuple could not be stored
  */ 
-uint mh_store_list(List *list, uint id, HashTableMH *hash_table)
+uint mh_store_tuple(ullong *minhashes, uint id, HashTableMH *hash_table)
 {
-     uint index;
-   
-     // get index of the hash table
-     index = mh_get_index(list, hash_table);
+     if (mh_check_storage(hash_table) != LSH_OK)
+          return LSH_NO_INDEX;
 
-     if (hash_table->buckets[index].items.size == 0){ // mark used bucket
-          Item new_used_bucket = {index, 1};
-          list_push(&hash_table->used_buckets, new_used_bucket);
-     }
-
-     // store list id in the hash table
-     Item new_item = {id, 1};
-     list_push(&hash_table->buckets[index].items, new_item);
+     // get index of the hash table
+     uint index = mh_get_tuple_index(minhashes, hash_table);
+     if (mh_store_at(index, id, hash_table) != LSH_OK)
+          return LSH_NO_INDEX;
 
      return index;
 }
@@ -378,93 +753,978 @@ uint mh_store_list(List *list, uint id, HashTableMH *hash_table)
  *
  * @param listdb Database of lists to be hashed
  * @param hash_table Hash table
- * @param indices Indices of the used buckets
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty lists)
+ *
+ * @return LSH_OK or the status of the first list that could not be stored
  */ 
-void mh_store_listdb(ListDB *listdb, HashTableMH *hash_table, uint *indices)
+int mh_store_listdb(ListDB *listdb, HashTableMH *hash_table, uint *indices)
 {
      uint i;   
          
-     // hash all lists in the database
-     for (i = 0; i < listdb->size; i++)
-          if (listdb ->lists[i].size > 0)
-               indices[i] = mh_store_list(&listdb->lists[i], i, hash_table);
+     // hash all non-empty lists in the database
+     for (i = 0; i < listdb->size; i++){
+          if (listdb->lists[i].size == 0)
+               indices[i] = LSH_NO_INDEX;
+          else if ((indices[i] = mh_store_list(&listdb->lists[i], i, hash_table)) == LSH_NO_INDEX)
+               return hash_table->storage != NULL ? LSH_INVALID : LSH_NO_MEMORY;
+     }
+
+     return LSH_OK;
 }
 
 /**
- * @brief Computes the cumulative maximum frequencies of a database of lists
+ * @brief Stores a band of a signature matrix in the hash table in bulk
+ *        (see mh_store_listdb_bulk and mh_store_signatures).
  *
- * @param listdb Database of lists
- * @param ifindex Inverted file index of the database of lists
+ * @param signatures Signature matrix
+ * @param listdb Database of lists the signatures were computed from
+ * @param band Number of the band
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty lists)
  *
- * @return Array with the cumulative maximum frequencies
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (the table is not empty)
  */ 
-uint *mh_get_cumulative_frequency(ListDB *listdb, ListDB *ifindex)
+int mh_store_signatures_bulk(SignatureDB *signatures, ListDB *listdb, uint band, HashTableMH *hash_table,
+                             uint *indices)
 {
-     uint i, j, k;
+     uint i;
+     uint number_of_ids = 0, number_of_buckets = 0;
+     size_t offset = (size_t) band * hash_table->tuple_size;
 
-     // computes the cumulative maximum frequency of the inverted index
-     uint *maxfreq = calloc(ifindex->size, sizeof(uint));
-     Item *maxitem = list_max_freq(&ifindex->lists[0]);
-     maxfreq[0] = maxitem->freq;
-     for (i = 1; i < ifindex->size; i++) {    
-          maxitem = list_max_freq(&ifindex->lists[i]);
-          maxfreq[i] = maxfreq[i - 1] + maxitem->freq;
+     if (offset + hash_table->tuple_size > signatures->number_of_values){
+          fprintf(stderr,"Error: Band %u is out of range for signatures of %u values\n",
+                  band, signatures->number_of_values);
+          return LSH_INVALID;
      }
 
-     return maxfreq;
+     if (listdb->size != signatures->size){
+          fprintf(stderr,"Error: Signatures of %u lists do not match a database of %u lists\n",
+                  signatures->size, listdb->size);
+          return LSH_INVALID;
+     }
+
+     if (hash_table->storage != NULL || hash_table->used_buckets.size != 0){
+          fprintf(stderr,"Error: Bulk build requires an empty hash table\n");
+          return LSH_INVALID;
+     }
+
+     // computes bucket indices and counts the IDs of each bucket
+     for (i = 0; i < signatures->size; i++){
+          ullong *row = &signatures->values[(size_t) i * signatures->number_of_values];
+          if (listdb->lists[i].size == 0){
+               indices[i] = LSH_NO_INDEX;
+               continue;
+          }
+          indices[i] = mh_get_tuple_index(row + offset, hash_table);
+          if (indices[i] == LSH_NO_INDEX){
+               mh_discard_counts(hash_table);
+               return LSH_NO_MEMORY;
+          }
+          if (hash_table->buckets[indices[i]].items.size++ == 0)
+               number_of_buckets++;
+          number_of_ids++;
+     }
+
+     return mh_layout_buckets(hash_table, indices, signatures->size, number_of_ids, number_of_buckets);
 }
 
 /**
- * @brief Generates a database of lists with frequencies equal to 1
- *        from a database of lists with frequencies greater than 1
- *
- * @param listdb Database of lists with frequencies greater than 1
- * @param maxfreq Array with the cumulative maximum frequencies
- *                to generate an expanded set of items
+ * @brief Sets the largest number of IDs a bucket may keep and the policy
+ *        applied by mh_limit_buckets to the buckets that exceed it. The
+ *        MH_BUCKET_SPLIT policy draws its extra MinHash functions from the
+ *        random number generator.
  *
- * @return Expanded database of lists with frequencies equal to 1
- */ 
-ListDB mh_expand_listdb(ListDB *listdb, uint *maxfreq)
+ * @param hash_table Hash table
+ * @param max_bucket_size Largest number of IDs in a bucket (0 for no limit)
+ * @param policy MH_BUCKET_KEEP, MH_BUCKET_SAMPLE, MH_BUCKET_SPLIT or MH_BUCKET_STOP
+ */
+void mh_set_bucket_limit(HashTableMH *hash_table, uint max_bucket_size, uint policy)
 {
-     uint i, j, k;
-     ListDB expldb = listdb_create(listdb->size, maxfreq[listdb->dim - 1] - 1);
+     uint i;
 
-     // creates a binary listdb with the cumulative maximum frequency
-     for (i = 0; i < listdb->size; i++) {
-          for (j = 0; j < listdb->lists[i].size; j++) {
-               for (k = 0; k < listdb->lists[i].data[j].freq; k++) {
-                    if (listdb->lists[i].data[j].item != 0) {
-                         Item item = {maxfreq[listdb->lists[i].data[j].item - 1] + k, 1};
-                         list_push(&expldb.lists[i], item);
-                    } else {
-                         Item item = {k, 1};
-                         list_push(&expldb.lists[i], item);
-                    }
-               }
+     hash_table->max_bucket_size = max_bucket_size;
+     hash_table->bucket_policy = policy;
+     if (policy == MH_BUCKET_SPLIT){
+          for (i = 0; i < MH_MAX_SPLITS; i++){
+               hash_table->split_seeds[i] = genrand64_int64();
+               hash_table->split_a[i] = univhash_coefficient(genrand64_int64());
           }
      }
-     
-     return expldb;
 }
 
 /**
- * @brief Expands an array of weights based on an expanded set of items
+ * @brief Computes an extra MinHash value of a list (set semantics) used
+ *        to split overflowing buckets
  *
- * @param ifindex Inverted file index of the database of lists
- * @param maxfreq Array with the cumulative maximum frequencies
- *                to generate the expanded set of items
- * @param weights Weights of the original set of items
+ * @param list List
+ * @param seed Seed of the MinHash function
  *
- * @return Array with the weights of the expanded set of items
- */ 
-double *mh_expand_weights(uint number_of_items, uint *maxfreq, double *weights)
+ * @return MinHash value
+ */
+ullong mh_split_minhash(List *list, ullong seed)
 {
-     uint i, j;
-     double *new_weights = (double *) malloc(maxfreq[number_of_items - 1] * sizeof(double));
+     uint i;
+     ullong minhash = LARGEST_INT64;
 
-     for (j = 0; j < maxfreq[0]; j++) 
-          new_weights[j] = weights[0];
-          
+     for (i = 0; i < list->size; i++){
+          ullong key = mh_hash_item(seed, list->data[i].item);
+          if (key < minhash)
+               minhash = key;
+     }
+
+     return minhash;
+}
+
+/**
+ * @brief Applies the bucket policy of a hash table to one of its buckets.
+ *        MH_BUCKET_STOP empties the bucket. MH_BUCKET_SAMPLE keeps a
+ *        uniform sample of max_bucket_size IDs, drawn deterministically
+ *        from the bucket's hash value. MH_BUCKET_SPLIT moves each ID to a
+ *        new bucket keyed by the bucket's hash value and an extra MinHash
+ *        value of its list, and splits the new buckets that still
+ *        overflow with the next extra value. After MH_MAX_SPLITS levels,
+ *        or when no lists are given, the bucket is sampled instead.
+ *
+ * @param hash_table Hash table
+ * @param index Index of the bucket
+ * @param listdb Database of the stored lists (NULL if not available)
+ * @param indices Bucket index of each ID, updated when IDs move (can be NULL)
+ * @param level Number of extra MinHash values already used on the bucket
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int mh_limit_bucket(HashTableMH *hash_table, uint index, ListDB *listdb, uint *indices, uint level)
+{
+     uint i;
+     uint max_bucket_size = hash_table->max_bucket_size;
+     List *items = &hash_table->buckets[index].items;
+
+     if (items->size <= max_bucket_size || hash_table->bucket_policy == MH_BUCKET_KEEP)
+          return LSH_OK;
+
+     if (hash_table->bucket_policy == MH_BUCKET_STOP){
+          items->size = 0;
+          return LSH_OK;
+     }
+
+     if (hash_table->bucket_policy == MH_BUCKET_SAMPLE || listdb == NULL || level == MH_MAX_SPLITS){
+          // partial Fisher-Yates shuffle of the first max_bucket_size IDs
+          ullong state = hash_table->buckets[index].hash_value;
+          for (i = 0; i < max_bucket_size; i++){
+               state = mh_mix64(state + 0x9E3779B97F4A7C15ULL);
+               uint j = i + (uint) (state % (items->size - i));
+               Item tmp = items->data[i];
+               items->data[i] = items->data[j];
+               items->data[j] = tmp;
+          }
+          items->size = max_bucket_size;
+          return LSH_OK;
+     }
+
+     // moves the IDs to new buckets (the array of buckets may be reallocated)
+     ullong hash_value = hash_table->buckets[index].hash_value;
+     Item *data = items->data;
+     uint size = items->size;
+     uint first_new = hash_table->used_buckets.size;
+     items->size = 0;
+     for (i = 0; i < size; i++){
+          uint id = data[i].item;
+          ullong key = univhash_add(hash_value, hash_table->split_a[level],
+                                    mh_split_minhash(&listdb->lists[id], hash_table->split_seeds[level]));
+          uint new_index = mh_probe(hash_table, key);
+          if (new_index == LSH_NO_INDEX)
+               return LSH_NO_MEMORY;
+
+          BucketMH *bucket = &hash_table->buckets[new_index];
+          if (bucket->position == LSH_NO_INDEX) // mark used bucket
+               mh_use_bucket(hash_table, new_index);
+          if (arena_push(&hash_table->arena, &bucket->items, data[i]) != LSH_OK)
+               return LSH_NO_MEMORY;
+          if (indices != NULL)
+               indices[id] = new_index;
+     }
+
+     // splits the new buckets that still overflow
+     uint last_new = hash_table->used_buckets.size;
+     for (i = first_new; i < last_new; i++){
+          int status = mh_limit_bucket(hash_table, hash_table->used_buckets.data[i].item, listdb,
+                                       indices, level + 1);
+          if (status != LSH_OK)
+               return status;
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Applies the bucket policy of a hash table (see mh_set_bucket_limit)
+ *        to all its buckets with more than max_bucket_size IDs. The
+ *        overflowing buckets are reported in the overflowed list of the
+ *        table (item: bucket index, freq: number of IDs before applying
+ *        the policy) until the table is cleared, also under MH_BUCKET_KEEP,
+ *        which leaves them unchanged.
+ *
+ * @param hash_table Hash table
+ * @param listdb Database of the stored lists (NULL if not available)
+ * @param indices Bucket index of each ID, updated when IDs move (can be NULL)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int mh_limit_buckets(HashTableMH *hash_table, ListDB *listdb, uint *indices)
+{
+     uint i;
+     uint number_of_used = hash_table->used_buckets.size;
+
+     if (hash_table->max_bucket_size == 0)
+          return LSH_OK;
+
+     for (i = 0; i < number_of_used; i++){
+          uint index = hash_table->used_buckets.data[i].item;
+          uint size = hash_table->buckets[index].items.size;
+          if (size > hash_table->max_bucket_size){
+               Item overflow = {index, size};
+               list_push(&hash_table->overflowed, overflow);
+
+               int status = mh_limit_bucket(hash_table, index, listdb, indices, 0);
+               if (status != LSH_OK)
+                    return status;
+          }
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Moves an ID to the bucket of its new tuple of MinHash values. The
+ *        ID is only moved if the bucket changes; a bucket left empty stays
+ *        in the list of used buckets until the table is cleared.
+ *
+ * @param minhashes New tuple of tuple_size MinHash values
+ * @param id ID of the list
+ * @param index Index of the bucket where the ID is currently stored
+ * @param hash_table Hash table
+ *
+ * @return Index of the bucket where the ID is stored, LSH_NO_INDEX if it
+ *         could not be moved (it then stays in its current bucket)
+ */ 
+uint mh_update_tuple(ullong *minhashes, uint id, uint index, HashTableMH *hash_table)
+{
+     uint i;
+     ullong hash_value = mh_univhash_tuple(minhashes, hash_table);
+
+     // IDs of tables built in bulk can only stay in their bucket, which is
+     // looked up without probing so that no bucket is created
+     if (hash_table->storage != NULL)
+          return bucketdir_find(&hash_table->directory, hash_value) == index ? index : LSH_NO_INDEX;
+
+     uint new_index = mh_probe(hash_table, hash_value);
+     if (new_index == index)
+          return index;
+
+     if (new_index == LSH_NO_INDEX)
+          return LSH_NO_INDEX;
+
+     // removes ID from its current bucket
+     List *items = &hash_table->buckets[index].items;
+     for (i = 0; i < items->size; i++)
+          if (items->data[i].item == id)
+               break;
+     if (i < items->size){
+          memmove(items->data + i, items->data + i + 1, (items->size - i - 1) * sizeof(Item));
+          items->size--;
+     }
+
+     mh_store_at(new_index, id, hash_table);
+
+     return new_index;
+}
+
+/**
+ * @brief Updates MinHash values of the MH_HASHED scheme with items newly
+ *        added to a list. Since each MinHash value is the minimum key of the
+ *        list, it only needs to be compared with the keys of the new items,
+ *        which costs O(tuple_size * |new_items|) instead of rehashing the
+ *        whole list. The frequency of each new item must be its frequency in
+ *        the updated list; a larger frequency never increases its key.
+ *
+ * @param minhashes MinHash values of the list before adding the items
+ * @param new_items Items added to the list
+ * @param seeds Seeds of the MinHash functions
+ * @param weights Weight of each item (NULL for unit weights)
+ * @param tuple_size Number of MinHash functions
+ *
+ * @return Number of MinHash values that changed
+ */
+uint mh_update_hashed_minhashes(ullong *minhashes, List *new_items, ullong *seeds, double *weights,
+                                uint tuple_size)
+{
+     uint i, j;
+     uint changed = 0;
+
+     for (i = 0; i < new_items->size; i++){
+          uint item = new_items->data[i].item;
+          double weight = (double) new_items->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+
+          for (j = 0; j < tuple_size; j++){
+               ullong key = mh_hash_item(seeds[j], item);
+               if (weight != 1.0)
+                    key = mh_weighted_key(key, weight);
+               if (minhashes[j] > key){
+                    minhashes[j] = key;
+                    changed++;
+               }
+          }
+     }
+
+     return changed;
+}
+
+/**
+ * @brief Updates a row of a signature matrix with items newly added to the
+ *        corresponding list and moves the ID of the list in the hash tables
+ *        whose band actually changed. Rows of lists that were empty, whose
+ *        index in the first table is LSH_NO_INDEX, are stored in all the
+ *        hash tables. Only signatures of the MH_HASHED
+ *        scheme can be updated incrementally, since the other schemes do
+ *        not keep enough information in the signature (OPH densification,
+ *        ICWS and frequency-scaled permutations).
+ *
+ * @param signatures Signature matrix (not memory-mapped)
+ * @param id ID of the list (row of the matrix)
+ * @param new_items Items added to the list, with their updated frequencies
+ * @param sketcher Hash table whose MinHash functions computed the signatures
+ * @param hash_tables Hash tables where bands are stored (one per band)
+ * @param number_of_tables Number of hash tables
+ * @param indices Bucket of each ID in each table (indices[table * size + id])
+ *
+ * @return Number of tables where the ID was moved or stored, LSH_INVALID if
+ *         the signatures cannot be updated, LSH_NO_MEMORY if the ID could
+ *         not be moved
+ */
+int mh_update_signature(SignatureDB *signatures, uint id, List *new_items, HashTableMH *sketcher,
+                        HashTableMH *hash_tables, uint number_of_tables, uint *indices)
+{
+     uint i;
+     int moved = 0;
+     ullong *row = &signatures->values[(size_t) id * signatures->number_of_values];
+     uint was_empty = (number_of_tables > 0 && indices[id] == LSH_NO_INDEX);
+
+     if (sketcher->scheme != MH_HASHED || signatures->mapping != NULL){
+          fprintf(stderr,"Error: Only in-memory MH_HASHED signatures can be updated\n");
+          return LSH_INVALID;
+     }
+
+     if (new_items->size == 0)
+          return 0;
+
+     for (i = 0; i < number_of_tables; i++){
+          uint tuple_size = hash_tables[i].tuple_size;
+          size_t offset = (size_t) i * tuple_size;
+          uint *index = &indices[(size_t) i * signatures->size + id];
+
+          // only bands whose values changed can move between buckets
+          if (mh_update_hashed_minhashes(row + offset, new_items, sketcher->seeds + offset,
+                                         sketcher->weights, tuple_size) == 0 && !was_empty)
+               continue;
+
+          uint new_index;
+          if (was_empty)
+               new_index = mh_store_tuple(row + offset, id, &hash_tables[i]);
+          else
+               new_index = mh_update_tuple(row + offset, id, *index, &hash_tables[i]);
+
+          if (new_index == LSH_NO_INDEX)
+               return LSH_NO_MEMORY;
+          moved += (was_empty || new_index != *index);
+          *index = new_index;
+     }
+
+     return moved;
+}
+
+/**
+ * @brief Initializes a signature matrix structure
+ *
+ * @param signatures Signature matrix
+ */
+void mh_signatures_init(SignatureDB *signatures)
+{
+     signatures->size = 0;
+     signatures->number_of_values = 0;
+     signatures->values = NULL;
+     signatures->mapping = NULL;
+     signatures->mapping_size = 0;
+}
+
+/**
+ * @brief Creates a signature matrix of size x number_of_values MinHash values
+ *
+ * @param size Number of lists
+ * @param number_of_values Number of MinHash values per list
+ *
+ * @return Signature matrix
+ */
+SignatureDB mh_signatures_create(uint size, uint number_of_values)
+{
+     SignatureDB signatures;
+
+     signatures.size = size;
+     signatures.number_of_values = number_of_values;
+     signatures.values = (ullong *) malloc((size_t) size * number_of_values * sizeof(ullong));
+     signatures.mapping = NULL;
+     signatures.mapping_size = 0;
+
+     return signatures;
+}
+
+/**
+ * @brief Destroys a signature matrix
+ *
+ * @param signatures Signature matrix
+ */
+void mh_signatures_destroy(SignatureDB *signatures)
+{
+     if (signatures->mapping != NULL)
+          munmap(signatures->mapping, signatures->mapping_size);
+     else
+          free(signatures->values);
+     mh_signatures_init(signatures);
+}
+
+/**
+ * @brief Computes the signature matrix of a database of lists in a single
+ *        pass. Row i holds the tuple_size MinHash values of list i computed
+ *        with the functions of the sketcher, so any band of tuple_size
+ *        consecutive columns can later be stored in a hash table with
+ *        mh_store_signatures. Rows of empty lists are filled with
+ *        LARGEST_INT64; they are never stored, since the store functions
+ *        skip the empty lists of the database.
+ *
+ * @param listdb Database of lists
+ * @param sketcher Hash table whose MinHash functions (tuple_size of them) are used
+ *
+ * @return Signature matrix
+ */
+SignatureDB mh_sketch_listdb(ListDB *listdb, HashTableMH *sketcher)
+{
+     uint i, j;
+     SignatureDB signatures = mh_signatures_create(listdb->size, sketcher->tuple_size);
+
+     for (i = 0; i < listdb->size; i++){
+          ullong *row = &signatures.values[(size_t) i * signatures.number_of_values];
+          if (listdb->lists[i].size > 0)
+               mh_compute_tuple(&listdb->lists[i], sketcher, row);
+          else
+               for (j = 0; j < signatures.number_of_values; j++)
+                    row[j] = LARGEST_INT64;
+     }
+
+     return signatures;
+}
+
+/**
+ * @brief Stores a band of a signature matrix in a hash table. The band
+ *        is made of the columns [band * tuple_size, (band + 1) * tuple_size)
+ *        of the matrix, where tuple_size is the one of the hash table.
+ *
+ * @param signatures Signature matrix
+ * @param listdb Database of lists the signatures were computed from
+ * @param band Number of the band
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty lists)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID
+ */ 
+int mh_store_signatures(SignatureDB *signatures, ListDB *listdb, uint band, HashTableMH *hash_table,
+                        uint *indices)
+{
+     uint i;
+     size_t offset = (size_t) band * hash_table->tuple_size;
+
+     if (offset + hash_table->tuple_size > signatures->number_of_values){
+          fprintf(stderr,"Error: Band %u is out of range for signatures of %u values\n",
+                  band, signatures->number_of_values);
+          return LSH_INVALID;
+     }
+
+     if (listdb->size != signatures->size){
+          fprintf(stderr,"Error: Signatures of %u lists do not match a database of %u lists\n",
+                  signatures->size, listdb->size);
+          return LSH_INVALID;
+     }
+
+     // hash the band of the rows of all non-empty lists
+     for (i = 0; i < signatures->size; i++){
+          ullong *row = &signatures->values[(size_t) i * signatures->number_of_values];
+          if (listdb->lists[i].size == 0)
+               indices[i] = LSH_NO_INDEX;
+          else if ((indices[i] = mh_store_tuple(row + offset, i, hash_table)) == LSH_NO_INDEX)
+               return hash_table->storage != NULL ? LSH_INVALID : LSH_NO_MEMORY;
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Computes a fingerprint of a database of lists from its size,
+ *        dimensionality and the items and frequencies of all its lists.
+ *
+ * @param listdb Database of lists
+ *
+ * @return 64-bit fingerprint
+ */
+ullong mh_listdb_fingerprint(ListDB *listdb)
+{
+     uint i, j;
+     ullong fingerprint = mh_mix64(((ullong) listdb->size << 32) | listdb->dim);
+
+     for (i = 0; i < listdb->size; i++){
+          fingerprint = mh_mix64(fingerprint + listdb->lists[i].size);
+          for (j = 0; j < listdb->lists[i].size; j++)
+               fingerprint = mh_mix64(fingerprint + (((ullong) listdb->lists[i].data[j].item << 32) |
+                                                     listdb->lists[i].data[j].freq));
+     }
+
+     return fingerprint;
+}
+
+/**
+ * @brief Saves a signature matrix to a binary file. The file starts with
+ *        a versioned header holding the key of the signatures (scheme,
+ *        seed, tuple size, number of tuples and dataset fingerprint),
+ *        followed by the matrix in row-major order.
+ *
+ * @param filename Name of the file
+ * @param signatures Signature matrix
+ * @param key Parameters the signatures were computed with
+ *
+ * @return 0 on success, -1 if the file could not be written
+ */
+int mh_signatures_save(char *filename, SignatureDB *signatures, SignatureKey *key)
+{
+     FILE *file;
+     SignatureFileHeader header;
+     size_t number_of_values = (size_t) signatures->size * signatures->number_of_values;
+
+     if (!(file = fopen(filename,"wb"))) {
+          fprintf(stderr,"Error: Could not create file %s\n", filename);
+          return -1;
+     }
+
+     memset(&header, 0, sizeof(SignatureFileHeader));
+     strncpy(header.magic, MH_SIGNATURE_MAGIC, sizeof(header.magic));
+     header.version = MH_SIGNATURE_VERSION;
+     header.scheme = key->scheme;
+     header.tuple_size = key->tuple_size;
+     header.number_of_tuples = key->number_of_tuples;
+     header.seed = key->seed;
+     header.fingerprint = key->fingerprint;
+     header.size = signatures->size;
+     header.number_of_values = signatures->number_of_values;
+
+     if (fwrite(&header, sizeof(SignatureFileHeader), 1, file) != 1 ||
+         fwrite(signatures->values, sizeof(ullong), number_of_values, file) != number_of_values) {
+          fprintf(stderr,"Error: Could not write file %s\n", filename);
+          fclose(file);
+          return -1;
+     }
+
+     if (fclose(file)) {
+          fprintf(stderr,"Error: Could not close file %s\n", filename);
+          return -1;
+     }
+
+     return 0;
+}
+
+/**
+ * @brief Memory-maps a signature matrix saved with mh_signatures_save.
+ *        The matrix is only mapped if the file has the current version and
+ *        was computed with the given key; otherwise an empty signature
+ *        matrix (values set to NULL) is returned.
+ *
+ * @param filename Name of the file
+ * @param key Parameters the signatures must have been computed with
+ *
+ * @return Memory-mapped signature matrix (read-only)
+ */
+SignatureDB mh_signatures_map(char *filename, SignatureKey *key)
+{
+     int fd;
+     struct stat st;
+     void *mapping;
+     SignatureFileHeader *header;
+     SignatureDB signatures;
+
+     mh_signatures_init(&signatures);
+     if ((fd = open(filename, O_RDONLY)) < 0)
+          return signatures;
+
+     if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(SignatureFileHeader)) {
+          close(fd);
+          return signatures;
+     }
+
+     mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+     close(fd);
+     if (mapping == MAP_FAILED)
+          return signatures;
+
+     // checks version, key and size of the file
+     header = (SignatureFileHeader *) mapping;
+     if (strncmp(header->magic, MH_SIGNATURE_MAGIC, sizeof(header->magic)) != 0 ||
+         header->version != MH_SIGNATURE_VERSION ||
+         header->scheme != key->scheme ||
+         header->tuple_size != key->tuple_size ||
+         header->number_of_tuples != key->number_of_tuples ||
+         header->seed != key->seed ||
+         header->fingerprint != key->fingerprint ||
+         (size_t) st.st_size != sizeof(SignatureFileHeader) +
+         (size_t) header->size * header->number_of_values * sizeof(ullong)) {
+          munmap(mapping, st.st_size);
+          return signatures;
+     }
+
+     signatures.size = header->size;
+     signatures.number_of_values = header->number_of_values;
+     signatures.values = (ullong *) ((char *) mapping + sizeof(SignatureFileHeader));
+     signatures.mapping = mapping;
+     signatures.mapping_size = st.st_size;
+
+     return signatures;
+}
+
+/**
+ * @brief Initializes a b-bit signature matrix structure
+ *
+ * @param signatures b-bit signature matrix
+ */
+void mh_bbit_init(BbitSignatureDB *signatures)
+{
+     signatures->size = 0;
+     signatures->number_of_values = 0;
+     signatures->bits = 0;
+     signatures->words_per_row = 0;
+     signatures->words = NULL;
+}
+
+/**
+ * @brief Creates a b-bit signature matrix where each MinHash value is
+ *        reduced to its lowest b bits and packed into 64-bit words.
+ *
+ * @param size Number of lists
+ * @param number_of_values Number of MinHash values per list
+ * @param bits Number of bits kept per value (1, 2, 4 or 8)
+ *
+ * @return b-bit signature matrix
+ */
+BbitSignatureDB mh_bbit_create(uint size, uint number_of_values, uint bits)
+{
+     BbitSignatureDB signatures;
+
+     if (bits != 1 && bits != 2 && bits != 4 && bits != 8){
+          fprintf(stderr,"Error: %u bits per value not supported (use 1, 2, 4 or 8)\n", bits);
+          mh_bbit_init(&signatures);
+          return signatures;
+     }
+
+     signatures.size = size;
+     signatures.number_of_values = number_of_values;
+     signatures.bits = bits;
+     signatures.words_per_row = (number_of_values * bits + 63) / 64;
+     signatures.words = (ullong *) calloc((size_t) size * signatures.words_per_row, sizeof(ullong));
+
+     return signatures;
+}
+
+/**
+ * @brief Destroys a b-bit signature matrix
+ *
+ * @param signatures b-bit signature matrix
+ */
+void mh_bbit_destroy(BbitSignatureDB *signatures)
+{
+     free(signatures->words);
+     mh_bbit_init(signatures);
+}
+
+/**
+ * @brief Compresses a signature matrix by keeping the lowest b bits of
+ *        each MinHash value. Rows of empty lists become all ones and are
+ *        skipped by mh_store_bbit_signatures.
+ *
+ * @param signatures Signature matrix
+ * @param bits Number of bits kept per value (1, 2, 4 or 8)
+ *
+ * @return b-bit signature matrix
+ */
+BbitSignatureDB mh_bbit_compress(SignatureDB *signatures, uint bits)
+{
+     uint i, j;
+     BbitSignatureDB bbit = mh_bbit_create(signatures->size, signatures->number_of_values, bits);
+     ullong mask = (1ULL << bits) - 1;
+
+     if (bbit.words == NULL)
+          return bbit;
+
+     for (i = 0; i < signatures->size; i++){
+          ullong *row = &signatures->values[(size_t) i * signatures->number_of_values];
+          ullong *words = &bbit.words[(size_t) i * bbit.words_per_row];
+          for (j = 0; j < signatures->number_of_values; j++){
+               uint offset = j * bits;
+               words[offset >> 6] |= (row[j] & mask) << (offset & 63);
+          }
+     }
+
+     return bbit;
+}
+
+/**
+ * @brief Gets a b-bit value of a b-bit signature matrix
+ *
+ * @param signatures b-bit signature matrix
+ * @param row Row (list) of the value
+ * @param col Column (MinHash function) of the value
+ *
+ * @return b-bit value
+ */
+uint mh_bbit_get(BbitSignatureDB *signatures, uint row, uint col)
+{
+     uint offset = col * signatures->bits;
+     ullong word = signatures->words[(size_t) row * signatures->words_per_row + (offset >> 6)];
+
+     return (uint) ((word >> (offset & 63)) & ((1ULL << signatures->bits) - 1));
+}
+
+/**
+ * @brief Counts the b-bit values that are equal in two rows of a b-bit
+ *        signature matrix. The XOR of both rows is folded so that each
+ *        mismatching b-bit value leaves a single bit set.
+ *
+ * @param signatures b-bit signature matrix
+ * @param row1 First row
+ * @param row2 Second row
+ *
+ * @return Number of equal b-bit values
+ */
+uint mh_bbit_matches(BbitSignatureDB *signatures, uint row1, uint row2)
+{
+     uint i;
+     uint mismatches = 0;
+     ullong *words1 = &signatures->words[(size_t) row1 * signatures->words_per_row];
+     ullong *words2 = &signatures->words[(size_t) row2 * signatures->words_per_row];
+
+     for (i = 0; i < signatures->words_per_row; i++){
+          ullong x = words1[i] ^ words2[i];
+          switch (signatures->bits){
+          case 2:
+               x = (x | (x >> 1)) & 0x5555555555555555ULL;
+               break;
+          case 4:
+               x |= x >> 1;
+               x = (x | (x >> 2)) & 0x1111111111111111ULL;
+               break;
+          case 8:
+               x |= x >> 1;
+               x |= x >> 2;
+               x = (x | (x >> 4)) & 0x0101010101010101ULL;
+               break;
+          }
+          mismatches += __builtin_popcountll(x);
+     }
+
+     return signatures->number_of_values - mismatches;
+}
+
+/**
+ * @brief Estimates the Jaccard similarity from the fraction of equal b-bit
+ *        MinHash values, correcting for the values that are equal only
+ *        because of the reduced number of bits [Li and Konig, WWW 2010].
+ *
+ * @param matches Fraction of equal b-bit values
+ * @param bits Number of bits per value
+ * @param r1 Size of the first list relative to the number of items (0 for sparse data)
+ * @param r2 Size of the second list relative to the number of items (0 for sparse data)
+ *
+ * @return Estimated Jaccard similarity
+ */
+double mh_bbit_estimate(double matches, uint bits, double r1, double r2)
+{
+     double c1, c2, estimate;
+     double values = (double) (1U << bits);
+
+     if (r1 + r2 <= 0.0){
+          c1 = c2 = 1.0 / values;
+     } else {
+          double a1 = r1 > 0.0 ? r1 * pow(1.0 - r1, values - 1.0) / (1.0 - pow(1.0 - r1, values)) : 1.0 / values;
+          double a2 = r2 > 0.0 ? r2 * pow(1.0 - r2, values - 1.0) / (1.0 - pow(1.0 - r2, values)) : 1.0 / values;
+          c1 = (a1 * r2 + a2 * r1) / (r1 + r2);
+          c2 = (a1 * r1 + a2 * r2) / (r1 + r2);
+     }
+
+     estimate = (matches - c1) / (1.0 - c2);
+     if (estimate < 0.0)
+          return 0.0;
+     if (estimate > 1.0)
+          return 1.0;
+
+     return estimate;
+}
+
+/**
+ * @brief Estimates the Jaccard similarity of two lists from their b-bit
+ *        signatures assuming sparse data.
+ *
+ * @param signatures b-bit signature matrix
+ * @param row1 First row
+ * @param row2 Second row
+ *
+ * @return Estimated Jaccard similarity
+ */
+double mh_bbit_jaccard(BbitSignatureDB *signatures, uint row1, uint row2)
+{
+     double matches = (double) mh_bbit_matches(signatures, row1, row2) / signatures->number_of_values;
+
+     return mh_bbit_estimate(matches, signatures->bits, 0.0, 0.0);
+}
+
+/**
+ * @brief Stores a band of a b-bit signature matrix in a hash table. The
+ *        band is made of the columns [band * tuple_size, (band + 1) * tuple_size)
+ *        of the matrix, where tuple_size is the one of the hash table. Since
+ *        a band of b-bit values has at most 2^(b * tuple_size) distinct
+ *        keys, tuple_size should be larger than for full MinHash values.
+ *
+ * @param signatures b-bit signature matrix
+ * @param listdb Database of lists the signatures were computed from
+ * @param band Number of the band
+ * @param hash_table Hash table
+ * @param indices Indices of the used buckets (LSH_NO_INDEX for empty lists)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID
+ */ 
+int mh_store_bbit_signatures(BbitSignatureDB *signatures, ListDB *listdb, uint band, HashTableMH *hash_table,
+                             uint *indices)
+{
+     uint i, j;
+     int status = LSH_OK;
+     uint offset = band * hash_table->tuple_size;
+     ullong stack_tuple[MH_STACK_TUPLE_SIZE];
+     ullong *tuple = stack_tuple;
+
+     if (offset + hash_table->tuple_size > signatures->number_of_values){
+          fprintf(stderr,"Error: Band %u is out of range for signatures of %u values\n",
+                  band, signatures->number_of_values);
+          return LSH_INVALID;
+     }
+
+     if (listdb->size != signatures->size){
+          fprintf(stderr,"Error: Signatures of %u lists do not match a database of %u lists\n",
+                  signatures->size, listdb->size);
+          return LSH_INVALID;
+     }
+
+     if (hash_table->tuple_size > MH_STACK_TUPLE_SIZE)
+          tuple = (ullong *) malloc(hash_table->tuple_size * sizeof(ullong));
+
+     for (i = 0; i < signatures->size; i++){
+          if (listdb->lists[i].size == 0){ // all ones, would share a bucket
+               indices[i] = LSH_NO_INDEX;
+               continue;
+          }
+          for (j = 0; j < hash_table->tuple_size; j++)
+               tuple[j] = mh_bbit_get(signatures, i, offset + j);
+          if ((indices[i] = mh_store_tuple(tuple, i, hash_table)) == LSH_NO_INDEX){
+               status = hash_table->storage != NULL ? LSH_INVALID : LSH_NO_MEMORY;
+               break;
+          }
+     }
+
+     if (tuple != stack_tuple)
+          free(tuple);
+
+     return status;
+}
+
+/**
+ * @brief Computes the cumulative maximum frequencies of a database of lists
+ *
+ * @param listdb Database of lists
+ * @param ifindex Inverted file index of the database of lists
+ *
+ * @return Array with the cumulative maximum frequencies
+ */ 
+uint *mh_get_cumulative_frequency(ListDB *listdb, ListDB *ifindex)
+{
+     uint i, j, k;
+
+     // computes the cumulative maximum frequency of the inverted index
+     uint *maxfreq = calloc(ifindex->size, sizeof(uint));
+     Item *maxitem = list_max_freq(&ifindex->lists[0]);
+     maxfreq[0] = maxitem->freq;
+     for (i = 1; i < ifindex->size; i++) {    
+          maxitem = list_max_freq(&ifindex->lists[i]);
+          maxfreq[i] = maxfreq[i - 1] + maxitem->freq;
+     }
+
+     return maxfreq;
+}
+
+/**
+ * @brief Generates a database of lists with frequencies equal to 1
+ *        from a database of lists with frequencies greater than 1.
+ *        The MH_WEIGHTED scheme hashes frequencies directly and makes
+ *        this expansion unnecessary.
+ *
+ * @param listdb Database of lists with frequencies greater than 1
+ * @param maxfreq Array with the cumulative maximum frequencies
+ *                to generate an expanded set of items
+ *
+ * @return Expanded database of lists with frequencies equal to 1
+ */ 
+ListDB mh_expand_listdb(ListDB *listdb, uint *maxfreq)
+{
+     uint i, j, k;
+     ListDB expldb = listdb_create(listdb->size, maxfreq[listdb->dim - 1] - 1);
+
+     // creates a binary listdb with the cumulative maximum frequency
+     for (i = 0; i < listdb->size; i++) {
+          for (j = 0; j < listdb->lists[i].size; j++) {
+               for (k = 0; k < listdb->lists[i].data[j].freq; k++) {
+                    if (listdb->lists[i].data[j].item != 0) {
+                         Item item = {maxfreq[listdb->lists[i].data[j].item - 1] + k, 1};
+                         list_push(&expldb.lists[i], item);
+                    } else {
+                         Item item = {k, 1};
+                         list_push(&expldb.lists[i], item);
+                    }
+               }
+          }
+     }
+     
+     return expldb;
+}
+
+/**
+ * @brief Expands an array of weights based on an expanded set of items
+ *
+ * @param ifindex Inverted file index of the database of lists
+ * @param maxfreq Array with the cumulative maximum frequencies
+ *                to generate the expanded set of items
+ * @param weights Weights of the original set of items
+ *
+ * @return Array with the weights of the expanded set of items
+ */ 
+double *mh_expand_weights(uint number_of_items, uint *maxfreq, double *weights)
+{
+     uint i, j;
+     double *new_weights = (double *) malloc(maxfreq[number_of_items - 1] * sizeof(double));
+
+     for (j = 0; j < maxfreq[0]; j++) 
+          new_weights[j] = weights[0];
+          
      for (i = 1; i < number_of_items; i++) {
           for (j = maxfreq[i - 1]; j < maxfreq[i]; j++) 
                new_weights[j] = weights[i];
@@ -472,3 +1732,235 @@ double *mh_expand_weights(uint number_of_items, uint *maxfreq, double *weights)
      
      return new_weights;
 }
+
+/**
+ * @brief Initializes a multi-table MinHash index structure to zero
+ *
+ * @param index Hash index structure
+ */
+void mh_index_init(HashIndexMH *index)
+{
+     index->number_of_tables = 0;
+     index->hash_tables = NULL;
+     mh_init(&index->sketcher);
+     locations_init(&index->locations, 0);
+}
+
+/**
+ * @brief Creates an index of number_of_tables hash tables. A single
+ *        sketcher computes the number_of_tables * tuple_size MinHash values
+ *        of a list at once, and band l of them is stored in table l.
+ *
+ * @param number_of_tables Number of hash tables
+ * @param table_size Initial number of buckets of each hash table
+ * @param tuple_size Number of MinHash values per tuple
+ * @param dim Size of the vocabulary
+ * @param scheme MinHash scheme (MH_PERMUTATIONS, MH_HASHED, MH_OPH or MH_WEIGHTED)
+ * @param weights Weight of each item (NULL for unit weights)
+ *
+ * @return Hash index structure
+ */
+HashIndexMH mh_index_create(uint number_of_tables, uint table_size, uint tuple_size, uint dim,
+                            uint scheme, double *weights)
+{
+     uint i;
+     HashIndexMH index;
+
+     mh_index_init(&index);
+     index.number_of_tables = number_of_tables;
+     locations_init(&index.locations, number_of_tables);
+     index.sketcher = mh_create_scheme(0, number_of_tables * tuple_size, dim, scheme);
+     index.sketcher.weights = weights;
+     mh_generate_functions(&index.sketcher);
+
+     // tables only hash the bands computed by the sketcher
+     index.hash_tables = (HashTableMH *) malloc(number_of_tables * sizeof(HashTableMH));
+     for (i = 0; i < number_of_tables; i++)
+          index.hash_tables[i] = mh_create_scheme(table_size, tuple_size, dim, MH_HASHED);
+
+     return index;
+}
+
+/**
+ * @brief Destroys a multi-table MinHash index structure
+ *
+ * @param index Hash index structure
+ */
+void mh_index_destroy(HashIndexMH *index)
+{
+     uint i;
+
+     for (i = 0; i < index->number_of_tables; i++)
+          mh_destroy(&index->hash_tables[i]);
+     free(index->hash_tables);
+     mh_destroy(&index->sketcher);
+     locations_destroy(&index->locations);
+     mh_index_init(index);
+}
+
+/**
+ * @brief Stores an ID in the bucket of each band of its MinHash values and
+ *        records its locations. Tables where the ID stays in the same
+ *        bucket are not modified.
+ *        If the ID cannot be stored in every table, the index is left as it
+ *        was (see index_store_buckets in lshtable.h).
+ *
+ * @param index Hash index structure
+ * @param id ID of the list (reserved in the locations of the index)
+ * @param minhashes MinHash values computed by the sketcher
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+static int mh_index_store(HashIndexMH *index, uint id, ullong *minhashes)
+{
+     uint j;
+     int status = LSH_OK;
+     uint tuple_size = index->sketcher.tuple_size / index->number_of_tables;
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+
+     if (buckets == NULL)
+          return LSH_NO_MEMORY;
+
+     for (j = 0; j < index->number_of_tables && status == LSH_OK; j++){
+          buckets[j] = mh_get_tuple_index(&minhashes[j * tuple_size], &index->hash_tables[j]);
+          if (buckets[j] == LSH_NO_INDEX)
+               status = LSH_NO_MEMORY;
+     }
+     if (status == LSH_OK)
+          status = mh_index_store_buckets(index, id, buckets);
+
+     free(buckets);
+
+     return status;
+}
+
+/**
+ * @brief Stores the lists of a database in all the tables of an index.
+ *        Each list is sketched once and its bands are stored in all the
+ *        tables before moving to the next list, so the list is only read
+ *        while it is in cache. Empty lists are not stored.
+ *
+ * @param index Hash index structure
+ * @param listdb Database of lists
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int mh_index_build(HashIndexMH *index, ListDB *listdb)
+{
+     uint i;
+     int status = LSH_OK;
+     ullong *minhashes = (ullong *) malloc(index->sketcher.tuple_size * sizeof(ullong));
+
+     if (minhashes == NULL && index->sketcher.tuple_size > 0)
+          return LSH_NO_MEMORY;
+
+     if (locations_reserve(&index->locations, listdb->size) != LSH_OK){
+          free(minhashes);
+          return LSH_NO_MEMORY;
+     }
+
+     for (i = 0; i < listdb->size && status == LSH_OK; i++){
+          if (listdb->lists[i].size == 0)
+               continue;
+
+          mh_compute_tuple(&listdb->lists[i], &index->sketcher, minhashes);
+          status = mh_index_store(index, i, minhashes);
+     }
+
+     free(minhashes);
+
+     return status;
+}
+
+/**
+ * @brief Inserts a list in the index or replaces a stored list with the
+ *        same ID. The list is sketched once and moved only in the tables
+ *        where its bucket changes; its old entries become stale (see
+ *        mh_index_delete). An empty list deletes the ID.
+ *
+ * @param index Hash index structure
+ * @param id ID of the list
+ * @param list New list
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or LSH_INVALID (a table was built in bulk)
+ */
+int mh_index_update(HashIndexMH *index, uint id, List *list)
+{
+     int status;
+     ullong *minhashes;
+
+     if (list->size == 0){
+          mh_index_delete(index, id);
+          return LSH_OK;
+     }
+
+     minhashes = (ullong *) malloc(index->sketcher.tuple_size * sizeof(ullong));
+     if ((minhashes == NULL && index->sketcher.tuple_size > 0) ||
+         locations_reserve(&index->locations, id + 1) != LSH_OK){
+          free(minhashes);
+          return LSH_NO_MEMORY;
+     }
+
+     mh_compute_tuple(list, &index->sketcher, minhashes);
+     status = mh_index_store(index, id, minhashes);
+     free(minhashes);
+
+     if (locations_need_compaction(&index->locations))
+          mh_index_compact(index);
+
+     return status;
+}
+
+/**
+ * @brief Retrieves the IDs stored in the index that collide with a list in
+ *        at least one table. Buckets are only looked up, so querying does
+ *        not modify the tables.
+ *
+ * @param index Hash index structure
+ * @param query List to be queried
+ *
+ * @return Sorted list of candidate IDs, whose frequencies are the numbers
+ *         of tables where they collide with the query
+ */
+List mh_index_query(HashIndexMH *index, List *query)
+{
+     uint i;
+     uint tuple_size = index->number_of_tables ? index->sketcher.tuple_size / index->number_of_tables : 0;
+     ullong *minhashes = (ullong *) malloc(index->sketcher.tuple_size * sizeof(ullong));
+     uint *buckets = (uint *) malloc(index->number_of_tables * sizeof(uint));
+     size_t number_of_candidates = 0;
+     List candidates;
+
+     list_init(&candidates);
+     if (query->size == 0 || minhashes == NULL || buckets == NULL){
+          free(minhashes);
+          free(buckets);
+          return candidates;
+     }
+
+     // finds the bucket of the query in each table
+     mh_compute_tuple(query, &index->sketcher, minhashes);
+     for (i = 0; i < index->number_of_tables; i++){
+          HashTableMH *hash_table = &index->hash_tables[i];
+          buckets[i] = bucketdir_find(&hash_table->directory,
+                                      mh_univhash_tuple(&minhashes[i * tuple_size], hash_table));
+          if (buckets[i] != LSH_NO_INDEX)
+               number_of_candidates += hash_table->buckets[buckets[i]].items.size;
+     }
+
+     // merges the buckets and removes repeated IDs
+     candidates.data = (Item *) malloc(number_of_candidates * sizeof(Item));
+     if (candidates.data != NULL){
+          for (i = 0; i < index->number_of_tables; i++)
+               if (buckets[i] != LSH_NO_INDEX)
+                    locations_append(&index->locations, i, buckets[i],
+                                     &index->hash_tables[i].buckets[buckets[i]].items, &candidates);
+          list_sort_by_item(&candidates);
+          list_unique(&candidates);
+     }
+
+     free(minhashes);
+     free(buckets);
+
+     return candidates;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file minhash_simd.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Vectorized MinHash kernels (AVX2 and AVX-512) chosen at runtime
+ *        from the features of the CPU, with the scalar loops of minhash.c
+ *        as fallback. The kernels compute 4 or 8 MinHash functions per
+ *        instruction with branch-free minima (compare and blend) and give
+ *        exactly the same values as the scalar code.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "minhash.h"
+#include "minhash_simd.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MH_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define MH_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+#define MH_MIX_MUL1 0xBF58476D1CE4E5B9ULL
+#define MH_MIX_MUL2 0x94D049BB133111EBULL
+
+static int mh_kernel = -1; // not selected yet
+
+/**
+ * @brief Detects the widest MinHash kernel supported by the CPU
+ *
+ * @return MH_KERNEL_AVX512, MH_KERNEL_AVX2 or MH_KERNEL_SCALAR
+ */
+uint mh_simd_detect(void)
+{
+#ifdef MH_SIMD_X86
+     __builtin_cpu_init();
+     if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+          return MH_KERNEL_AVX512;
+     if (__builtin_cpu_supports("avx2"))
+          return MH_KERNEL_AVX2;
+#endif
+     return MH_KERNEL_SCALAR;
+}
+
+/**
+ * @brief Gets the MinHash kernel in use, detecting it on first call. It
+ *        is called by the threads of the parallel stores, so the detected
+ *        kernel is published with a compare-and-swap and threads that
+ *        race on the first call all get the same kernel.
+ *
+ * @return Kernel in use
+ */
+uint mh_simd_get_kernel(void)
+{
+     int kernel = __atomic_load_n(&mh_kernel, __ATOMIC_ACQUIRE);
+
+     if (kernel < 0){
+          int expected = -1;
+          int detected = (int) mh_simd_detect();
+          if (__atomic_compare_exchange_n(&mh_kernel, &expected, detected, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+               kernel = detected;
+          else
+               kernel = expected; // selected by another thread
+     }
+
+     return (uint) kernel;
+}
+
+/**
+ * @brief Selects the MinHash kernel to be used. Kernels not supported by
+ *        the CPU are replaced by the widest supported one. The kernel is
+ *        stored atomically, so it can be changed while lists are being
+ *        hashed; since all kernels give the same values, hashes do not
+ *        depend on which kernel computed them.
+ *
+ * @param kernel Requested kernel
+ *
+ * @return Kernel in use
+ */
+uint mh_simd_set_kernel(uint kernel)
+{
+     uint supported = mh_simd_detect();
+     int selected = (int) (kernel < supported ? kernel : supported);
+
+     __atomic_store_n(&mh_kernel, selected, __ATOMIC_RELEASE);
+
+     return (uint) selected;
+}
+
+#ifdef MH_SIMD_X86
+/**
+ * @brief Minimum of permuted random values for the first blocks of 4 MinHash
+ *        functions (AVX2). The random values of 4 functions are loaded as two
+ *        256-bit vectors of (int, double) pairs and deinterleaved; the list
+ *        is traversed once and the minima of all blocks are kept in
+ *        min_values. Values are divided by the item frequency, as in the
+ *        scalar code, so that the minima do not depend on the kernel.
+ */
+__attribute__((target("avx2")))
+static void mh_avx2_minhashes(List *list, RandomValue *permutations, uint tuple_size,
+                              uint number_of_funcs, ullong *minhashes, double *min_values)
+{
+     uint i, j;
+
+     for (i = 0; i < list->size; i++){
+          const double *rv = (const double *) &permutations[(size_t) list->data[i].item * tuple_size];
+          __m256d freq = _mm256_set1_pd((double) list->data[i].freq);
+          for (j = 0; j < number_of_funcs; j += 4){
+               __m256d low = _mm256_loadu_pd(rv + 2 * j);
+               __m256d high = _mm256_loadu_pd(rv + 2 * j + 4);
+               __m256d values = _mm256_permute4x64_pd(_mm256_unpackhi_pd(low, high), 0xD8);
+               __m256d ints = _mm256_permute4x64_pd(_mm256_unpacklo_pd(low, high), 0xD8);
+               values = _mm256_div_pd(values, freq);
+
+               if (i > 0){
+                    __m256d current = _mm256_loadu_pd(min_values + j);
+                    __m256d smaller = _mm256_cmp_pd(values, current, _CMP_LT_OQ);
+                    values = _mm256_blendv_pd(current, values, smaller);
+                    ints = _mm256_blendv_pd(_mm256_loadu_pd((const double *) (minhashes + j)), ints, smaller);
+               }
+               _mm256_storeu_pd(min_values + j, values);
+               _mm256_storeu_pd((double *) (minhashes + j), ints);
+          }
+     }
+}
+
+/**
+ * @brief Minimum of permuted random values for the first blocks of 8 MinHash
+ *        functions (AVX-512)
+ */
+__attribute__((target("avx512f")))
+static void mh_avx512_minhashes(List *list, RandomValue *permutations, uint tuple_size,
+                                uint number_of_funcs, ullong *minhashes, double *min_values)
+{
+     uint i, j;
+     const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+     const __m512i even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+
+     for (i = 0; i < list->size; i++){
+          const double *rv = (const double *) &permutations[(size_t) list->data[i].item * tuple_size];
+          __m512d freq = _mm512_set1_pd((double) list->data[i].freq);
+          for (j = 0; j < number_of_funcs; j += 8){
+               __m512d low = _mm512_loadu_pd(rv + 2 * j);
+               __m512d high = _mm512_loadu_pd(rv + 2 * j + 8);
+               __m512d values = _mm512_div_pd(_mm512_permutex2var_pd(low, odd, high), freq);
+               __m512d ints = _mm512_permutex2var_pd(low, even, high);
+
+               if (i > 0){
+                    __m512d current = _mm512_loadu_pd(min_values + j);
+                    __mmask8 smaller = _mm512_cmp_pd_mask(values, current, _CMP_LT_OQ);
+                    values = _mm512_mask_mov_pd(current, smaller, values);
+                    ints = _mm512_mask_mov_pd(_mm512_loadu_pd((const double *) (minhashes + j)), smaller, ints);
+               }
+               _mm512_storeu_pd(min_values + j, values);
+               _mm512_storeu_pd((double *) (minhashes + j), ints);
+          }
+     }
+}
+
+/**
+ * @brief Low 64 bits of the product of 64-bit lanes (AVX2 has no 64-bit multiply)
+ */
+__attribute__((target("avx2")))
+static inline __m256i mh_avx2_mullo64(__m256i a, __m256i b, __m256i b_high)
+{
+     __m256i low = _mm256_mul_epu32(a, b);
+     __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                      _mm256_mul_epu32(a, b_high));
+
+     return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+/**
+ * @brief Minimum keys of the MH_HASHED scheme for 4 MinHash functions (AVX2).
+ *        Items whose weight is not 1 are mapped to their weighted keys lane
+ *        by lane.
+ */
+__attribute__((target("avx2")))
+static void mh_avx2_hashed_block(List *list, ullong *seeds, double *weights, uint func,
+                                 ullong *minhashes)
+{
+     uint i, j;
+     const __m256i sign = _mm256_set1_epi64x((long long) 0x8000000000000000ULL);
+     const __m256i mul1 = _mm256_set1_epi64x((long long) MH_MIX_MUL1);
+     const __m256i mul1_high = _mm256_srli_epi64(mul1, 32);
+     const __m256i mul2 = _mm256_set1_epi64x((long long) MH_MIX_MUL2);
+     const __m256i mul2_high = _mm256_srli_epi64(mul2, 32);
+     __m256i seed = _mm256_loadu_si256((const __m256i *) (seeds + func));
+     __m256i min_keys = _mm256_set1_epi64x((long long) LARGEST_INT64);
+
+     for (i = 0; i < list->size; i++){
+          uint item = list->data[i].item;
+          double weight = (double) list->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+
+          // SplitMix64 finalizer of seed + (item + 1) * golden gamma
+          __m256i x = _mm256_add_epi64(seed, _mm256_set1_epi64x((long long) (((ullong) item + 1) * MH_GOLDEN_GAMMA)));
+          x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 30));
+          x = mh_avx2_mullo64(x, mul1, mul1_high);
+          x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 27));
+          x = mh_avx2_mullo64(x, mul2, mul2_high);
+          x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 31));
+
+          if (weight != 1.0){
+               ullong keys[4];
+               _mm256_storeu_si256((__m256i *) keys, x);
+               for (j = 0; j < 4; j++)
+                    keys[j] = mh_weighted_key(keys[j], weight);
+               x = _mm256_loadu_si256((const __m256i *) keys);
+          }
+
+          // unsigned 64-bit minimum through signed comparison
+          __m256i greater = _mm256_cmpgt_epi64(_mm256_xor_si256(min_keys, sign), _mm256_xor_si256(x, sign));
+          min_keys = _mm256_blendv_epi8(min_keys, x, greater);
+     }
+
+     _mm256_storeu_si256((__m256i *) (minhashes + func), min_keys);
+}
+
+/**
+ * @brief Minimum keys of the MH_HASHED scheme for 8 MinHash functions (AVX-512)
+ */
+__attribute__((target("avx512f,avx512dq")))
+static void mh_avx512_hashed_block(List *list, ullong *seeds, double *weights, uint func,
+                                   ullong *minhashes)
+{
+     uint i, j;
+     const __m512i mul1 = _mm512_set1_epi64((long long) MH_MIX_MUL1);
+     const __m512i mul2 = _mm512_set1_epi64((long long) MH_MIX_MUL2);
+     __m512i seed = _mm512_loadu_si512((const void *) (seeds + func));
+     __m512i min_keys = _mm512_set1_epi64((long long) LARGEST_INT64);
+
+     for (i = 0; i < list->size; i++){
+          uint item = list->data[i].item;
+          double weight = (double) list->data[i].freq;
+          if (weights != NULL)
+               weight *= weights[item];
+
+          __m512i x = _mm512_add_epi64(seed, _mm512_set1_epi64((long long) (((ullong) item + 1) * MH_GOLDEN_GAMMA)));
+          x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 30));
+          x = _mm512_mullo_epi64(x, mul1);
+          x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 27));
+          x = _mm512_mullo_epi64(x, mul2);
+          x = _mm512_xor_si512(x, _mm512_srli_epi64(x, 31));
+
+          if (weight != 1.0){
+               ullong keys[8];
+               _mm512_storeu_si512((void *) keys, x);
+               for (j = 0; j < 8; j++)
+                    keys[j] = mh_weighted_key(keys[j], weight);
+               x = _mm512_loadu_si512((const void *) keys);
+          }
+
+          min_keys = _mm512_min_epu64(min_keys, x);
+     }
+
+     _mm512_storeu_si512((void *) (minhashes + func), min_keys);
+}
+#endif
+
+/**
+ * @brief Computes the MinHash values of a list for all the MinHash functions
+ *        of the MH_PERMUTATIONS scheme with the selected kernel. Functions
+ *        left over after the last full vector are computed with the scalar
+ *        code.
+ *
+ * @param list List to be hashed
+ * @param permutations Random values in item-major order
+ * @param tuple_size Number of MinHash functions
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_simd_compute_minhashes(List *list, RandomValue *permutations, uint tuple_size, ullong *minhashes)
+{
+     uint func = 0;
+
+#ifdef MH_SIMD_X86
+     uint kernel = mh_simd_get_kernel();
+     double stack_values[MH_STACK_TUPLE_SIZE];
+     double *min_values = stack_values;
+
+     if (kernel != MH_KERNEL_SCALAR && tuple_size >= 4){
+          if (tuple_size > MH_STACK_TUPLE_SIZE)
+               min_values = (double *) malloc(tuple_size * sizeof(double));
+
+          if (min_values == NULL) // without memory for the minima the scalar code is used
+               func = 0;
+          else if (kernel == MH_KERNEL_AVX512 && tuple_size >= 8){
+               func = tuple_size & ~7U;
+               mh_avx512_minhashes(list, permutations, tuple_size, func, minhashes, min_values);
+          } else {
+               func = tuple_size & ~3U;
+               mh_avx2_minhashes(list, permutations, tuple_size, func, minhashes, min_values);
+          }
+
+          if (min_values != stack_values)
+               free(min_values);
+     }
+#endif
+
+     if (func == 0)
+          mh_compute_minhashes(list, permutations, tuple_size, minhashes);
+     else
+          for (; func < tuple_size; func++)
+               minhashes[func] = mh_compute_minhash(list, permutations, tuple_size, func);
+}
+
+/**
+ * @brief Computes the MinHash values of a list for all the MinHash functions
+ *        of the MH_HASHED scheme with the selected kernel. Functions left
+ *        over after the last full vector are computed with the scalar code.
+ *
+ * @param list List to be hashed
+ * @param seeds Seeds of the MinHash functions
+ * @param weights Weight of each item (NULL for unit weights)
+ * @param tuple_size Number of MinHash functions
+ * @param minhashes Array where the tuple_size MinHash values are stored
+ */
+void mh_simd_compute_hashed_minhashes(List *list, ullong *seeds, double *weights, uint tuple_size,
+                                      ullong *minhashes)
+{
+     uint func = 0;
+
+#ifdef MH_SIMD_X86
+     uint kernel = mh_simd_get_kernel();
+     if (kernel == MH_KERNEL_AVX512)
+          for (; func + 8 <= tuple_size; func += 8)
+               mh_avx512_hashed_block(list, seeds, weights, func, minhashes);
+     if (kernel >= MH_KERNEL_AVX2)
+          for (; func + 4 <= tuple_size; func += 4)
+               mh_avx2_hashed_block(list, seeds, weights, func, minhashes);
+#endif
+
+     if (func < tuple_size)
+          mh_compute_hashed_minhashes(list, seeds + func, weights, tuple_size - func, minhashes + func);
+}
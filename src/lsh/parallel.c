@@ -0,0 +1,343 @@
+/**
+ * @file parallel.c
+ * @author Gibran Fuentes Pineda <gibranfp@turing.iimas.unam.mx>
+ * @date 2015
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Concurrent construction of hash tables. The IDs of a database
+ *        are split in contiguous ranges, one per thread, and each thread
+ *        computes the keys of its IDs and inserts them in a shared bucket
+ *        directory (see parallel_insert), counting the IDs of each bucket
+ *        with atomic increments. Buckets are then renumbered in
+ *        the order of their first ID and the IDs are appended to contiguous
+ *        bucket segments through atomic cursors. Segments are finally
+ *        sorted, so the resulting table does not depend on the number of
+ *        threads and is the same as the one built by a single thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+typedef struct ParallelRemapping {
+     BucketDir *dir;
+     uint *indices;
+     uint *renumbering;
+     ullong *keys;
+} ParallelRemapping;
+
+typedef struct ParallelLayout {
+     uint *indices;
+     uint *cursors;
+     uint *offsets;
+     Item *storage;
+} ParallelLayout;
+
+/**
+ * @brief Number of threads to use. If no number is given, one thread per
+ *        online processor is used.
+ *
+ * @param number_of_threads Requested number of threads (0 for all processors)
+ *
+ * @return Number of threads between 1 and PARALLEL_MAX_THREADS
+ */
+uint parallel_number_of_threads(uint number_of_threads)
+{
+     if (number_of_threads == 0){
+          long processors = sysconf(_SC_NPROCESSORS_ONLN);
+          number_of_threads = processors > 0 ? (uint) processors : 1;
+     }
+
+     return number_of_threads > PARALLEL_MAX_THREADS ? PARALLEL_MAX_THREADS : number_of_threads;
+}
+
+/**
+ * @brief Entry point of the threads started by parallel_for
+ */
+static void *parallel_run_task(void *arg)
+{
+     ParallelTask *task = (ParallelTask *) arg;
+     task->work(task->arg, task->start, task->end);
+
+     return NULL;
+}
+
+/**
+ * @brief Calls a function on contiguous ranges of [0, size) from several
+ *        threads and waits for all of them. The calling thread processes
+ *        the first range, and ranges whose thread cannot be started are
+ *        also processed by the calling thread.
+ *
+ * @param number_of_threads Number of threads (0 for all processors)
+ * @param size Number of elements
+ * @param work Function called with arg and a range [start, end)
+ * @param arg Argument of the function
+ */
+void parallel_for(uint number_of_threads, uint size, ParallelWork work, void *arg)
+{
+     uint i;
+     pthread_t *threads;
+     ParallelTask *tasks;
+     int *started;
+
+     number_of_threads = parallel_number_of_threads(number_of_threads);
+     if (number_of_threads > size)
+          number_of_threads = size;
+     if (number_of_threads <= 1){
+          if (size > 0)
+               work(arg, 0, size);
+          return;
+     }
+
+     threads = (pthread_t *) malloc(number_of_threads * sizeof(pthread_t));
+     tasks = (ParallelTask *) malloc(number_of_threads * sizeof(ParallelTask));
+     started = (int *) calloc(number_of_threads, sizeof(int));
+     if (threads == NULL || tasks == NULL || started == NULL){ // runs serially
+          free(threads);
+          free(tasks);
+          free(started);
+          work(arg, 0, size);
+          return;
+     }
+
+     for (i = 0; i < number_of_threads; i++){
+          tasks[i].work = work;
+          tasks[i].arg = arg;
+          tasks[i].start = (uint) ((ullong) size * i / number_of_threads);
+          tasks[i].end = (uint) ((ullong) size * (i + 1) / number_of_threads);
+     }
+
+     for (i = 1; i < number_of_threads; i++)
+          started[i] = pthread_create(&threads[i], NULL, parallel_run_task, &tasks[i]) == 0;
+
+     parallel_run_task(&tasks[0]);
+     for (i = 1; i < number_of_threads; i++){
+          if (started[i])
+               pthread_join(threads[i], NULL);
+          else
+               parallel_run_task(&tasks[i]);
+     }
+
+     free(threads);
+     free(tasks);
+     free(started);
+}
+
+/**
+ * @brief Initializes a structure of concurrently counted buckets to zero
+ *
+ * @param buckets Buckets
+ */
+void parallel_buckets_init(ParallelBuckets *buckets)
+{
+     buckets->number_of_buckets = 0;
+     buckets->number_of_ids = 0;
+     buckets->keys = NULL;
+     buckets->offsets = NULL;
+}
+
+/**
+ * @brief Destroys a structure of concurrently counted buckets
+ *
+ * @param buckets Buckets
+ */
+void parallel_buckets_destroy(ParallelBuckets *buckets)
+{
+     free(buckets->keys);
+     free(buckets->offsets);
+     parallel_buckets_init(buckets);
+}
+
+/**
+ * @brief Replaces the temporary bucket numbers of a range of IDs
+ */
+static void parallel_remap_ids(void *arg, uint start, uint end)
+{
+     ParallelRemapping *remapping = (ParallelRemapping *) arg;
+     uint i;
+
+     for (i = start; i < end; i++)
+          if (remapping->indices[i] != LSH_NO_INDEX)
+               remapping->indices[i] = remapping->renumbering[remapping->indices[i]];
+}
+
+/**
+ * @brief Replaces the temporary bucket numbers of a range of directory
+ *        slots and collects the key of each bucket
+ */
+static void parallel_remap_slots(void *arg, uint start, uint end)
+{
+     ParallelRemapping *remapping = (ParallelRemapping *) arg;
+     BucketDirSlot *slots = remapping->dir->slots;
+     uint i;
+
+     for (i = start; i < end; i++){
+          if (remapping->dir->ctrl[i] == BUCKETDIR_EMPTY)
+               continue;
+          slots[i].bucket = remapping->renumbering[slots[i].bucket];
+          remapping->keys[slots[i].bucket] = slots[i].key;
+     }
+}
+
+/**
+ * @brief Computes the buckets of a set of IDs from several threads. Keys
+ *        are inserted in the bucket directory, which must be empty and have
+ *        room for size keys (see bucketdir_reserve). Buckets are numbered
+ *        in the order of their first ID, as a single thread would number
+ *        them, and their keys and the offsets of their segments in a
+ *        contiguous array of IDs are returned.
+ *
+ * @param dir Bucket directory
+ * @param size Number of IDs
+ * @param work Function called with the shared ParallelHashing state and a
+ *        range of IDs, which calls parallel_insert with the key of each ID
+ * @param data Data of the work function (data field of the shared state)
+ * @param number_of_threads Number of threads (0 for all processors)
+ * @param indices Bucket of each ID (LSH_NO_INDEX for IDs that are not stored)
+ * @param buckets Keys and offsets of the buckets
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int parallel_hash_ids(BucketDir *dir, uint size, ParallelWork work, void *data,
+                      uint number_of_threads, uint *indices, ParallelBuckets *buckets)
+{
+     uint i, number_of_buckets = 0;
+     uint *renumbering;
+     ParallelHashing hashing;
+     ParallelRemapping remapping;
+
+     parallel_buckets_init(buckets);
+     hashing.dir = dir;
+     hashing.data = data;
+     hashing.indices = indices;
+     hashing.counts = (uint *) calloc(size > 0 ? size : 1, sizeof(uint));
+     hashing.first = (uint *) malloc((size > 0 ? size : 1) * sizeof(uint));
+     hashing.next_bucket = 0;
+     hashing.status = LSH_OK;
+     if (hashing.counts == NULL || hashing.first == NULL){
+          free(hashing.counts);
+          free(hashing.first);
+          return LSH_NO_MEMORY;
+     }
+     memset(hashing.first, 0xff, size * sizeof(uint));
+
+     parallel_for(number_of_threads, size, work, &hashing);
+
+     renumbering = (uint *) malloc((hashing.next_bucket > 0 ? hashing.next_bucket : 1) * sizeof(uint));
+     buckets->keys = (ullong *) malloc((hashing.next_bucket > 0 ? hashing.next_bucket : 1) * sizeof(ullong));
+     buckets->offsets = (uint *) malloc((hashing.next_bucket + 1) * sizeof(uint));
+     if (hashing.status != LSH_OK || renumbering == NULL || buckets->keys == NULL || buckets->offsets == NULL){
+          free(hashing.counts);
+          free(hashing.first);
+          free(renumbering);
+          parallel_buckets_destroy(buckets);
+          return LSH_NO_MEMORY;
+     }
+
+     // numbers buckets in the order of their first ID
+     for (i = 0; i < size; i++)
+          if (indices[i] != LSH_NO_INDEX && hashing.first[indices[i]] == i)
+               renumbering[indices[i]] = number_of_buckets++;
+
+     buckets->offsets[0] = 0;
+     for (i = 0; i < number_of_buckets; i++)
+          buckets->offsets[renumbering[i] + 1] = hashing.counts[i];
+     for (i = 0; i < number_of_buckets; i++)
+          buckets->offsets[i + 1] += buckets->offsets[i];
+     buckets->number_of_buckets = number_of_buckets;
+     buckets->number_of_ids = buckets->offsets[number_of_buckets];
+
+     remapping.dir = dir;
+     remapping.indices = indices;
+     remapping.renumbering = renumbering;
+     remapping.keys = buckets->keys;
+     parallel_for(number_of_threads, size, parallel_remap_ids, &remapping);
+     parallel_for(number_of_threads, dir->capacity, parallel_remap_slots, &remapping);
+
+     free(hashing.counts);
+     free(hashing.first);
+     free(renumbering);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Appends a range of IDs to the segments of their buckets
+ */
+static void parallel_scatter_ids(void *arg, uint start, uint end)
+{
+     ParallelLayout *layout = (ParallelLayout *) arg;
+     uint i, position;
+
+     for (i = start; i < end; i++){
+          if (layout->indices[i] == LSH_NO_INDEX)
+               continue;
+          position = __atomic_fetch_add(&layout->cursors[layout->indices[i]], 1, __ATOMIC_RELAXED);
+          layout->storage[position].item = i;
+          layout->storage[position].freq = 1;
+     }
+}
+
+/**
+ * @brief Sorts the segments of a range of buckets by ID
+ */
+static void parallel_sort_segments(void *arg, uint start, uint end)
+{
+     ParallelLayout *layout = (ParallelLayout *) arg;
+     uint i;
+     List segment;
+
+     for (i = start; i < end; i++){
+          segment.size = layout->offsets[i + 1] - layout->offsets[i];
+          segment.data = layout->storage + layout->offsets[i];
+          if (segment.size > 1)
+               list_sort_by_item(&segment);
+     }
+}
+
+/**
+ * @brief Lays out the IDs of buckets computed by parallel_hash_ids in a
+ *        contiguous array from several threads. Each thread appends its IDs
+ *        to the segments of their buckets through atomic cursors, and the
+ *        segments are then sorted by ID.
+ *
+ * @param buckets Keys and offsets of the buckets
+ * @param indices Bucket of each ID
+ * @param size Number of IDs
+ * @param storage Array of buckets->number_of_ids items
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int parallel_layout_ids(ParallelBuckets *buckets, uint *indices, uint size, Item *storage,
+                        uint number_of_threads)
+{
+     ParallelLayout layout;
+
+     layout.cursors = (uint *) malloc((buckets->number_of_buckets > 0 ? buckets->number_of_buckets : 1) * sizeof(uint));
+     if (layout.cursors == NULL)
+          return LSH_NO_MEMORY;
+     memcpy(layout.cursors, buckets->offsets, buckets->number_of_buckets * sizeof(uint));
+     layout.indices = indices;
+     layout.offsets = buckets->offsets;
+     layout.storage = storage;
+
+     parallel_for(number_of_threads, size, parallel_scatter_ids, &layout);
+     parallel_for(number_of_threads, buckets->number_of_buckets, parallel_sort_segments, &layout);
+     free(layout.cursors);
+
+     return LSH_OK;
+}
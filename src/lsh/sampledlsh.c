@@ -0,0 +1,1368 @@
+/**
+ * @file sampledlsh.c
+ * @author Gibran Fuentes-Pineda <gibranfp@unam.mx>
+ * @date 2016
+ *
+ * @section GPL
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @brief Functions for mining co-occurring items with Sampled
+ *        Locality-Sensitive Hashing (SLSH). Tables are processed in
+ *        batches of one table per thread: the random parameters of the
+ *        batch are drawn by the calling thread in table order, then each
+ *        thread stores the database in its table, extracts the co-occurring
+ *        items of its buckets and destroys the table. The mined lists are
+ *        merged in table order, so they do not depend on the number of
+ *        threads.
+ *
+ *        The streaming functions keep a single table instead: each tuple is
+ *        stored in it by all the threads, its co-occurring items are given
+ *        to a sink (e.g. a file writer) and the table is cleared for the
+ *        next tuple, so memory does not grow with the number of tuples or
+ *        with the mined lists.
+ *
+ *        The unique mining functions deduplicate the lists found by several
+ *        tables: the threads insert the hash of each list in a concurrent
+ *        set (see bucketdir_insert_concurrent) and count its multiplicity,
+ *        and the distinct lists are output in the order of their first
+ *        occurrence.
+ *
+ *        The top-k mining functions stream the tables to a bounded
+ *        min-heap that keeps the k best lists by size, multiplicity or a
+ *        user scoring function, so lists that rank below the k best are
+ *        discarded as soon as they are found.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sampledlsh.h"
+#include "bucketdir.h"
+#include "parallel.h"
+
+typedef struct SampledL1Mining {
+     ListDB *listdb;
+     HashTableL1 *hash_tables;
+     ListDB *coitems;
+     int *status;
+} SampledL1Mining;
+
+typedef struct SampledLPMining {
+     VectorDB *vectordb;
+     HashTableLP *hash_tables;
+     ListDB *coitems;
+     int *status;
+} SampledLPMining;
+
+typedef struct SampledSets {
+     BucketDir dir;
+     uint number_of_sets;
+     uint capacity;
+     List *lists;
+     uint *multiplicity;
+     ullong *first;
+     int status;
+} SampledSets;
+
+typedef struct SampledInsertion {
+     SampledSets *sets;
+     ListDB *coitems;
+     uint first_table;
+} SampledInsertion;
+
+typedef struct SampledOccurrence {
+     ullong first;
+     uint set;
+} SampledOccurrence;
+
+/**
+ * @brief Extracts the co-occurring items from the buckets of a L1LSH hash
+ *        table
+ *
+ * @param coitems Database of co-occurring items
+ * @param hash_table Hash table
+ */
+void sampledlsh_l1_get_coitems(ListDB *coitems, HashTableL1 *hash_table)
+{
+     uint i;
+
+     for (i = 0; i < hash_table->used_buckets.size; i++){
+          List *items = &hash_table->buckets[hash_table->used_buckets.data[i].item].items;
+          if (items->size > 1){
+               List coitem = list_duplicate(items);
+               listdb_push(coitems, &coitem);
+          }
+     }
+}
+
+/**
+ * @brief Extracts the co-occurring items from the buckets of a LPLSH hash
+ *        table
+ *
+ * @param coitems Database of co-occurring items
+ * @param hash_table Hash table
+ */
+void sampledlsh_lp_get_coitems(ListDB *coitems, HashTableLP *hash_table)
+{
+     uint i;
+
+     for (i = 0; i < hash_table->used_buckets.size; i++){
+          List *items = &hash_table->buckets[hash_table->used_buckets.data[i].item].items;
+          if (items->size > 1){
+               List coitem = list_duplicate(items);
+               listdb_push(coitems, &coitem);
+          }
+     }
+}
+
+/**
+ * @brief Appends the co-occurring items mined from a batch of tables in
+ *        table order
+ *
+ * @param coitems Database of co-occurring items
+ * @param table_coitems Co-occurring items of each table
+ * @param status Status of each table
+ * @param number_of_tables Number of tables of the batch
+ *
+ * @return LSH_OK or the status of the first table that could not be mined
+ */
+static int sampledlsh_merge(ListDB *coitems, ListDB *table_coitems, int *status, uint number_of_tables)
+{
+     uint j;
+     int batch_status = LSH_OK;
+
+     for (j = 0; j < number_of_tables; j++){
+          if (status[j] == LSH_OK){
+               if (table_coitems[j].size > 0)
+                    listdb_append(coitems, &table_coitems[j]);
+               free(table_coitems[j].lists); // lists are now owned by coitems
+          } else {
+               listdb_destroy(&table_coitems[j]);
+               if (batch_status == LSH_OK)
+                    batch_status = status[j];
+          }
+     }
+
+     return batch_status;
+}
+
+/**
+ * @brief Hashes a sorted list of co-occurring items
+ *
+ * @param list List of co-occurring items
+ *
+ * @return 64-bit hash value of the list
+ */
+static ullong sampledlsh_hash_set(List *list)
+{
+     uint i;
+     ullong hash = list->size;
+
+     for (i = 0; i < list->size; i++){
+          hash = (hash ^ list->data[i].item) * 0xbf58476d1ce4e5b9ULL;
+          hash ^= hash >> 31;
+     }
+
+     return hash;
+}
+
+/**
+ * @brief Checks if two lists of co-occurring items have the same items
+ *
+ * @param list1 First list
+ * @param list2 Second list
+ *
+ * @return 1 if the lists are equal, 0 otherwise
+ */
+static int sampledlsh_equal_sets(List *list1, List *list2)
+{
+     uint i;
+
+     if (list1->size != list2->size)
+          return 0;
+     for (i = 0; i < list1->size; i++)
+          if (list1->data[i].item != list2->data[i].item)
+               return 0;
+
+     return 1;
+}
+
+/**
+ * @brief Initializes a set of mined lists
+ *
+ * @param sets Set of mined lists
+ */
+static void sampledlsh_sets_init(SampledSets *sets)
+{
+     bucketdir_init(&sets->dir);
+     sets->number_of_sets = 0;
+     sets->capacity = 0;
+     sets->lists = NULL;
+     sets->multiplicity = NULL;
+     sets->first = NULL;
+     sets->status = LSH_OK;
+}
+
+/**
+ * @brief Destroys a set of mined lists and the lists it still owns
+ *
+ * @param sets Set of mined lists
+ */
+static void sampledlsh_sets_destroy(SampledSets *sets)
+{
+     uint i;
+
+     for (i = 0; i < sets->number_of_sets && i < sets->capacity; i++)
+          list_destroy(&sets->lists[i]);
+     bucketdir_destroy(&sets->dir);
+     free(sets->lists);
+     free(sets->multiplicity);
+     free(sets->first);
+     sampledlsh_sets_init(sets);
+}
+
+/**
+ * @brief Makes room for a given number of distinct lists, so that they
+ *        can be inserted concurrently
+ *
+ * @param sets Set of mined lists
+ * @param size Number of distinct lists
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+static int sampledlsh_sets_reserve(SampledSets *sets, uint size)
+{
+     uint i;
+     List *lists;
+     uint *multiplicity;
+     ullong *first;
+
+     if (bucketdir_reserve(&sets->dir, size) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     if (size <= sets->capacity)
+          return LSH_OK;
+
+     lists = (List *) realloc(sets->lists, size * sizeof(List));
+     if (lists == NULL)
+          return LSH_NO_MEMORY;
+     sets->lists = lists;
+     multiplicity = (uint *) realloc(sets->multiplicity, size * sizeof(uint));
+     if (multiplicity == NULL)
+          return LSH_NO_MEMORY;
+     sets->multiplicity = multiplicity;
+     first = (ullong *) realloc(sets->first, size * sizeof(ullong));
+     if (first == NULL)
+          return LSH_NO_MEMORY;
+     sets->first = first;
+
+     for (i = sets->capacity; i < size; i++){
+          list_init(&sets->lists[i]);
+          sets->multiplicity[i] = 0;
+          sets->first[i] = 18446744073709551615ULL;
+     }
+     sets->capacity = size;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Finds the set of a list in the set of mined lists, inserting it
+ *        if it is not there. The first thread that inserts a list claims
+ *        its set by a CAS of the data pointer and then publishes its size.
+ *        Other threads wait for the size and compare the items, so lists
+ *        whose hashes collide are not merged: on a mismatch, the next key
+ *        derived from the hash is probed.
+ *
+ * @param sets Set of mined lists
+ * @param list List of co-occurring items (with more than one item)
+ * @param claimed Set to 1 if the list was kept in a new set
+ *
+ * @return Number of the set, LSH_NO_INDEX if the set is full
+ */
+static uint sampledlsh_sets_find(SampledSets *sets, List *list, int *claimed)
+{
+     ullong hash = sampledlsh_hash_set(list);
+     ullong key = hash;
+     ullong probe = 0;
+
+     for (;;){
+          uint set = bucketdir_insert_concurrent(&sets->dir, key, &sets->number_of_sets);
+          if (set == LSH_NO_INDEX)
+               return LSH_NO_INDEX;
+
+          Item *empty = NULL;
+          if (__atomic_compare_exchange_n(&sets->lists[set].data, &empty, list->data, 0,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+               __atomic_store_n(&sets->lists[set].size, list->size, __ATOMIC_RELEASE);
+               *claimed = 1;
+               return set;
+          }
+
+          List kept = {0, empty};
+          while ((kept.size = __atomic_load_n(&sets->lists[set].size, __ATOMIC_ACQUIRE)) == 0)
+               ; // claimed by another thread, which is publishing its size
+          if (sampledlsh_equal_sets(&kept, list)){
+               *claimed = 0;
+               return set;
+          }
+
+          probe++; // hash collision with a different list
+          key = (hash + probe * 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+          key ^= key >> 31;
+     }
+}
+
+/**
+ * @brief Inserts the lists mined from a range of tables of a batch in the
+ *        set of mined lists (see sampledlsh_sets_find). The first thread
+ *        that inserts a list keeps it and the other copies are destroyed.
+ *        Each occurrence is numbered by its table and position, and the
+ *        smallest number of each list is kept to output the lists in a
+ *        deterministic order.
+ */
+static void sampledlsh_insert_range(void *arg, uint start, uint end)
+{
+     uint j, k;
+     SampledInsertion *insertion = (SampledInsertion *) arg;
+     SampledSets *sets = insertion->sets;
+
+     for (j = start; j < end; j++){
+          ListDB *coitems = &insertion->coitems[j];
+          for (k = 0; k < coitems->size; k++){
+               List *list = &coitems->lists[k];
+               int claimed = 0;
+               uint set = sampledlsh_sets_find(sets, list, &claimed);
+               if (set == LSH_NO_INDEX){
+                    __atomic_store_n(&sets->status, LSH_NO_MEMORY, __ATOMIC_RELAXED);
+                    list_destroy(list);
+                    continue;
+               }
+
+               __atomic_fetch_add(&sets->multiplicity[set], 1, __ATOMIC_RELAXED);
+
+               ullong occurrence = ((ullong) (insertion->first_table + j) << 32) | k;
+               ullong first = __atomic_load_n(&sets->first[set], __ATOMIC_RELAXED);
+               while (occurrence < first && !__atomic_compare_exchange_n(&sets->first[set], &first, occurrence, 1,
+                                                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+               if (!claimed) // already kept by another occurrence
+                    list_destroy(list);
+          }
+          free(coitems->lists);
+          listdb_init(coitems);
+     }
+}
+
+/**
+ * @brief Inserts the co-occurring items mined from a batch of tables in
+ *        the set of mined lists
+ *
+ * @param sets Set of mined lists
+ * @param table_coitems Co-occurring items of each table
+ * @param status Status of each table
+ * @param number_of_tables Number of tables of the batch
+ * @param first_table Number of the first table of the batch
+ * @param number_of_threads Number of threads
+ *
+ * @return LSH_OK or the status of the first table that could not be mined
+ */
+static int sampledlsh_merge_unique(SampledSets *sets, ListDB *table_coitems, int *status,
+                                   uint number_of_tables, uint first_table, uint number_of_threads)
+{
+     uint j;
+     int batch_status = LSH_OK;
+     ullong size = sets->number_of_sets;
+     SampledInsertion insertion = {sets, table_coitems, first_table};
+
+     for (j = 0; j < number_of_tables; j++){
+          if (status[j] != LSH_OK){
+               listdb_destroy(&table_coitems[j]);
+               if (batch_status == LSH_OK)
+                    batch_status = status[j];
+          }
+          size += table_coitems[j].size;
+     }
+
+     if (size > LSH_NO_INDEX - 1 || sampledlsh_sets_reserve(sets, (uint) size) != LSH_OK)
+          batch_status = LSH_NO_MEMORY;
+
+     if (batch_status != LSH_OK){
+          for (j = 0; j < number_of_tables; j++)
+               listdb_destroy(&table_coitems[j]);
+          return batch_status;
+     }
+
+     parallel_for(number_of_threads, number_of_tables, sampledlsh_insert_range, &insertion);
+
+     return sets->status;
+}
+
+/**
+ * @brief Compares the first occurrences of two mined lists
+ */
+static int sampledlsh_occurrence_compare(const void *a, const void *b)
+{
+     const SampledOccurrence *occurrence1 = a;
+     const SampledOccurrence *occurrence2 = b;
+
+     if (occurrence1->first < occurrence2->first)
+          return -1;
+     else if (occurrence1->first > occurrence2->first)
+          return 1;
+     return 0;
+}
+
+/**
+ * @brief Moves the distinct lists of a set of mined lists to a database
+ *        in the order of their first occurrence
+ *
+ * @param sets Set of mined lists
+ * @param coitems Database of co-occurring items
+ * @param multiplicity Number of tables that found each list (item: position
+ *        of the list in the database, freq: multiplicity)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+static int sampledlsh_sets_collect(SampledSets *sets, ListDB *coitems, List *multiplicity)
+{
+     uint i;
+     uint size = sets->number_of_sets;
+     SampledOccurrence *occurrences = (SampledOccurrence *) malloc(size * sizeof(SampledOccurrence));
+
+     coitems->lists = (List *) malloc(size * sizeof(List));
+     multiplicity->data = (Item *) malloc(size * sizeof(Item));
+     if (size > 0 && (occurrences == NULL || coitems->lists == NULL || multiplicity->data == NULL)){
+          free(occurrences);
+          free(coitems->lists);
+          free(multiplicity->data);
+          coitems->lists = NULL;
+          list_init(multiplicity);
+          return LSH_NO_MEMORY;
+     }
+
+     for (i = 0; i < size; i++){
+          occurrences[i].first = sets->first[i];
+          occurrences[i].set = i;
+     }
+     qsort(occurrences, size, sizeof(SampledOccurrence), sampledlsh_occurrence_compare);
+
+     for (i = 0; i < size; i++){
+          uint set = occurrences[i].set;
+          coitems->lists[i] = sets->lists[set];
+          multiplicity->data[i].item = i;
+          multiplicity->data[i].freq = sets->multiplicity[set];
+          list_init(&sets->lists[set]); // now owned by coitems
+     }
+     coitems->size = size;
+     multiplicity->size = size;
+     free(occurrences);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Mines a range of tables of a L1LSH batch
+ */
+static void sampledlsh_l1_mine_range(void *arg, uint start, uint end)
+{
+     uint j;
+     SampledL1Mining *mining = (SampledL1Mining *) arg;
+     uint *indices = (uint *) malloc(mining->listdb->size * sizeof(uint));
+
+     for (j = start; j < end; j++){
+          listdb_init(&mining->coitems[j]);
+          if (indices == NULL && mining->listdb->size > 0)
+               mining->status[j] = LSH_NO_MEMORY;
+          else
+               mining->status[j] = l1lsh_store_listdb_bulk(mining->listdb, &mining->hash_tables[j], indices);
+
+          if (mining->status[j] == LSH_OK)
+               sampledlsh_l1_get_coitems(&mining->coitems[j], &mining->hash_tables[j]);
+          l1lsh_destroy(&mining->hash_tables[j]);
+     }
+
+     free(indices);
+}
+
+/**
+ * @brief Mines a range of tables of a LPLSH batch
+ */
+static void sampledlsh_lp_mine_range(void *arg, uint start, uint end)
+{
+     uint j;
+     SampledLPMining *mining = (SampledLPMining *) arg;
+     uint *indices = (uint *) malloc(mining->vectordb->size * sizeof(uint));
+
+     for (j = start; j < end; j++){
+          listdb_init(&mining->coitems[j]);
+          if (indices == NULL && mining->vectordb->size > 0)
+               mining->status[j] = LSH_NO_MEMORY;
+          else
+               mining->status[j] = lplsh_store_vectordb_bulk(mining->vectordb, &mining->hash_tables[j], indices);
+
+          if (mining->status[j] == LSH_OK)
+               sampledlsh_lp_get_coitems(&mining->coitems[j], &mining->hash_tables[j]);
+          lplsh_destroy(&mining->hash_tables[j]);
+     }
+
+     free(indices);
+}
+
+/**
+ * @brief Mines the tables of L1LSH in batches of one table per thread
+ *        (threads, 0 for all processors). The lists of each batch are
+ *        appended to coitems or, if sets is given, inserted in it.
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+static int sampledlsh_l1_mine_tables(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint max_value,
+                                     uint table_size, ListDB *coitems, SampledSets *sets, uint threads)
+{
+     uint i, j, batch;
+     int status = LSH_OK;
+     uint number_of_threads = parallel_number_of_threads(threads);
+     HashTableL1 *hash_tables = (HashTableL1 *) malloc(number_of_threads * sizeof(HashTableL1));
+     ListDB *table_coitems = (ListDB *) malloc(number_of_threads * sizeof(ListDB));
+     int *table_status = (int *) malloc(number_of_threads * sizeof(int));
+     SampledL1Mining mining = {listdb, hash_tables, table_coitems, table_status};
+
+     if (hash_tables == NULL || table_coitems == NULL || table_status == NULL)
+          status = LSH_NO_MEMORY;
+
+     for (i = 0; i < number_of_tuples && status == LSH_OK; i += batch){
+          batch = number_of_tuples - i < number_of_threads ? number_of_tuples - i : number_of_threads;
+          for (j = 0; j < batch; j++){
+               hash_tables[j] = l1lsh_create(table_size, tuple_size, listdb->dim, max_value);
+               l1lsh_generate_sample_bits(listdb->dim, max_value, tuple_size, hash_tables[j].sample_bits,
+                                          hash_tables[j].number_of_samples);
+          }
+          parallel_for(number_of_threads, batch, sampledlsh_l1_mine_range, &mining);
+          if (sets == NULL)
+               status = sampledlsh_merge(coitems, table_coitems, table_status, batch);
+          else
+               status = sampledlsh_merge_unique(sets, table_coitems, table_status, batch, i, number_of_threads);
+     }
+
+     free(hash_tables);
+     free(table_coitems);
+     free(table_status);
+
+     return status;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of lists with L1LSH.
+ *        Each of the number_of_tuples tables groups lists whose tuples of
+ *        sampled bits are equal, and the IDs of each bucket with more than
+ *        one list are a list of co-occurring items.
+ *
+ * @param listdb Database of lists (item frequencies of each dimension)
+ * @param tuple_size Number of sampled bits per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param max_value Largest value of an item frequency
+ * @param table_size Initial number of buckets of each table
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of co-occurring items
+ */
+ListDB sampledlsh_l1mine(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint max_value,
+                         uint table_size, uint number_of_threads)
+{
+     ListDB coitems;
+
+     listdb_init(&coitems);
+     coitems.dim = listdb->size;
+
+     if (sampledlsh_l1_mine_tables(listdb, tuple_size, number_of_tuples, max_value, table_size,
+                                   &coitems, NULL, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+
+     return coitems;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of lists with L1LSH
+ *        (see sampledlsh_l1mine), keeping only one copy of the lists
+ *        found by several tables.
+ *
+ * @param listdb Database of lists (item frequencies of each dimension)
+ * @param tuple_size Number of sampled bits per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param max_value Largest value of an item frequency
+ * @param table_size Initial number of buckets of each table
+ * @param multiplicity Number of tables that found each list (item:
+ *        position of the list, freq: multiplicity)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of distinct co-occurring items
+ */
+ListDB sampledlsh_l1mine_unique(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint max_value,
+                                uint table_size, List *multiplicity, uint number_of_threads)
+{
+     ListDB coitems;
+     SampledSets sets;
+
+     listdb_init(&coitems);
+     coitems.dim = listdb->size;
+     list_init(multiplicity);
+     sampledlsh_sets_init(&sets);
+
+     if (sampledlsh_l1_mine_tables(listdb, tuple_size, number_of_tuples, max_value, table_size,
+                                   NULL, &sets, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+     if (sampledlsh_sets_collect(&sets, &coitems, multiplicity) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to collect the mined lists\n");
+     sampledlsh_sets_destroy(&sets);
+
+     return coitems;
+}
+
+/**
+ * @brief Mines the tables of LPLSH in batches of one table per thread
+ *        (see sampledlsh_l1_mine_tables)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+static int sampledlsh_lp_mine_tables(VectorDB *vectordb, uint tuple_size, uint number_of_tuples, double width,
+                                     uint table_size, double (*ps_dist)(void), ListDB *coitems,
+                                     SampledSets *sets, uint threads)
+{
+     uint i, j, batch;
+     int status = LSH_OK;
+     uint number_of_threads = parallel_number_of_threads(threads);
+     HashTableLP *hash_tables = (HashTableLP *) malloc(number_of_threads * sizeof(HashTableLP));
+     ListDB *table_coitems = (ListDB *) malloc(number_of_threads * sizeof(ListDB));
+     int *table_status = (int *) malloc(number_of_threads * sizeof(int));
+     SampledLPMining mining = {vectordb, hash_tables, table_coitems, table_status};
+
+     if (hash_tables == NULL || table_coitems == NULL || table_status == NULL)
+          status = LSH_NO_MEMORY;
+
+     for (i = 0; i < number_of_tuples && status == LSH_OK; i += batch){
+          batch = number_of_tuples - i < number_of_threads ? number_of_tuples - i : number_of_threads;
+          for (j = 0; j < batch; j++){
+               hash_tables[j] = lplsh_create(table_size, tuple_size, vectordb->dim, width);
+               lplsh_generate_random_values(tuple_size, vectordb->dim, width, hash_tables[j].avec,
+                                            hash_tables[j].bval, ps_dist);
+          }
+          parallel_for(number_of_threads, batch, sampledlsh_lp_mine_range, &mining);
+          if (sets == NULL)
+               status = sampledlsh_merge(coitems, table_coitems, table_status, batch);
+          else
+               status = sampledlsh_merge_unique(sets, table_coitems, table_status, batch, i, number_of_threads);
+     }
+
+     free(hash_tables);
+     free(table_coitems);
+     free(table_status);
+
+     return status;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of vectors with LPLSH
+ *        (see sampledlsh_l1mine).
+ *
+ * @param vectordb Database of vectors
+ * @param tuple_size Number of hash values per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param width Width of the quantization bins
+ * @param table_size Initial number of buckets of each table
+ * @param ps_dist p-stable distribution (lplsh_rng_cauchy for l1,
+ *        lplsh_rng_gaussian for l2)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of co-occurring items
+ */
+ListDB sampledlsh_lpmine(VectorDB *vectordb, uint tuple_size, uint number_of_tuples, double width,
+                         uint table_size, double (*ps_dist)(void), uint number_of_threads)
+{
+     ListDB coitems;
+
+     listdb_init(&coitems);
+     coitems.dim = vectordb->size;
+
+     if (sampledlsh_lp_mine_tables(vectordb, tuple_size, number_of_tuples, width, table_size, ps_dist,
+                                   &coitems, NULL, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+
+     return coitems;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of vectors with LPLSH,
+ *        keeping only one copy of the lists found by several tables (see
+ *        sampledlsh_l1mine_unique).
+ *
+ * @param vectordb Database of vectors
+ * @param tuple_size Number of hash values per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param width Width of the quantization bins
+ * @param table_size Initial number of buckets of each table
+ * @param ps_dist p-stable distribution
+ * @param multiplicity Number of tables that found each list (item:
+ *        position of the list, freq: multiplicity)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of distinct co-occurring items
+ */
+ListDB sampledlsh_lpmine_unique(VectorDB *vectordb, uint tuple_size, uint number_of_tuples, double width,
+                                uint table_size, double (*ps_dist)(void), List *multiplicity,
+                                uint number_of_threads)
+{
+     ListDB coitems;
+     SampledSets sets;
+
+     listdb_init(&coitems);
+     coitems.dim = vectordb->size;
+     list_init(multiplicity);
+     sampledlsh_sets_init(&sets);
+
+     if (sampledlsh_lp_mine_tables(vectordb, tuple_size, number_of_tuples, width, table_size, ps_dist,
+                                   NULL, &sets, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+     if (sampledlsh_sets_collect(&sets, &coitems, multiplicity) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to collect the mined lists\n");
+     sampledlsh_sets_destroy(&sets);
+
+     return coitems;
+}
+
+/**
+ * @brief Sink writing co-occurring items to a file in the format of
+ *        listdb_save_to_file
+ *
+ * @param coitems List of co-occurring items
+ * @param file Open file (FILE *)
+ *
+ * @return 0 on success, -1 if the list could not be written
+ */
+int sampledlsh_write_coitems(List *coitems, void *file)
+{
+     uint i;
+     FILE *output = (FILE *) file;
+
+     fprintf(output,"%u", coitems->size);
+     for (i = 0; i < coitems->size; i++)
+          fprintf(output," %u:%u", coitems->data[i].item, coitems->data[i].freq);
+
+     return fprintf(output,"\n") < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of lists with L1LSH and
+ *        gives each list of co-occurring items to a sink as soon as its
+ *        table is processed (see sampledlsh_l1mine). A single table is
+ *        stored by all the threads and reused for all the tuples. Lists given to the sink are views of the
+ *        table and are only valid during the call.
+ *
+ * @param listdb Database of lists (item frequencies of each dimension)
+ * @param tuple_size Number of sampled bits per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param max_value Largest value of an item frequency
+ * @param table_size Initial number of buckets of the table
+ * @param sink Function called with each list of co-occurring items and
+ *        data, which stops mining if it returns nonzero
+ * @param data Argument of the sink
+ * @param threads Number of threads (0 for all processors)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or the nonzero value returned by the sink
+ */
+int sampledlsh_l1mine_stream(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint max_value,
+                             uint table_size, SampledSink sink, void *data, uint threads)
+{
+     uint i, j;
+     int status = LSH_OK;
+     uint number_of_threads = parallel_number_of_threads(threads);
+     HashTableL1 hash_table = l1lsh_create(table_size, tuple_size, listdb->dim, max_value);
+     uint *indices = (uint *) malloc(listdb->size * sizeof(uint));
+
+     if (indices == NULL && listdb->size > 0)
+          status = LSH_NO_MEMORY;
+
+     for (i = 0; i < number_of_tuples && status == LSH_OK; i++){
+          l1lsh_generate_functions(&hash_table);
+          if (number_of_threads == 1)
+               status = l1lsh_store_listdb_bulk(listdb, &hash_table, indices);
+          else
+               status = l1lsh_store_listdb_parallel(listdb, &hash_table, indices, number_of_threads);
+
+          for (j = 0; j < hash_table.used_buckets.size && status == LSH_OK; j++){
+               List *items = &hash_table.buckets[hash_table.used_buckets.data[j].item].items;
+               if (items->size > 1)
+                    status = sink(items, data);
+          }
+          l1lsh_clear_table(&hash_table);
+     }
+
+     free(indices);
+     l1lsh_destroy(&hash_table);
+
+     return status;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of vectors with LPLSH
+ *        and gives them to a sink (see sampledlsh_l1mine_stream).
+ *
+ * @param vectordb Database of vectors
+ * @param tuple_size Number of hash values per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param width Width of the quantization bins
+ * @param table_size Initial number of buckets of the table
+ * @param ps_dist p-stable distribution
+ * @param sink Function called with each list of co-occurring items and
+ *        data, which stops mining if it returns nonzero
+ * @param data Argument of the sink
+ * @param threads Number of threads (0 for all processors)
+ *
+ * @return LSH_OK, LSH_NO_MEMORY or the nonzero value returned by the sink
+ */
+int sampledlsh_lpmine_stream(VectorDB *vectordb, uint tuple_size, uint number_of_tuples, double width,
+                             uint table_size, double (*ps_dist)(void), SampledSink sink, void *data,
+                             uint threads)
+{
+     uint i, j;
+     int status = LSH_OK;
+     uint number_of_threads = parallel_number_of_threads(threads);
+     HashTableLP hash_table = lplsh_create(table_size, tuple_size, vectordb->dim, width);
+     uint *indices = (uint *) malloc(vectordb->size * sizeof(uint));
+
+     if (indices == NULL && vectordb->size > 0)
+          status = LSH_NO_MEMORY;
+
+     for (i = 0; i < number_of_tuples && status == LSH_OK; i++){
+          lplsh_generate_functions(&hash_table, ps_dist);
+          if (number_of_threads == 1)
+               status = lplsh_store_vectordb_bulk(vectordb, &hash_table, indices);
+          else
+               status = lplsh_store_vectordb_parallel(vectordb, &hash_table, indices, number_of_threads);
+
+          for (j = 0; j < hash_table.used_buckets.size && status == LSH_OK; j++){
+               List *items = &hash_table.buckets[hash_table.used_buckets.data[j].item].items;
+               if (items->size > 1)
+                    status = sink(items, data);
+          }
+          lplsh_clear_table(&hash_table);
+     }
+
+     free(indices);
+     lplsh_destroy(&hash_table);
+
+     return status;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of lists with L1LSH and
+ *        writes them to a file as each table is processed (see
+ *        sampledlsh_l1mine_stream). The file can be read with
+ *        listdb_load_from_file.
+ *
+ * @param filename Name of the output file
+ * @param listdb Database of lists
+ * @param tuple_size Number of sampled bits per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param max_value Largest value of an item frequency
+ * @param table_size Initial number of buckets of the table
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return 0 on success, -1 on error
+ */
+int sampledlsh_l1mine_to_file(char *filename, ListDB *listdb, uint tuple_size, uint number_of_tuples,
+                              uint max_value, uint table_size, uint number_of_threads)
+{
+     int status;
+     FILE *file;
+
+     if (!(file = fopen(filename,"w"))) {
+          fprintf(stderr,"Error: Could not create file %s\n", filename);
+          return -1;
+     }
+
+     status = sampledlsh_l1mine_stream(listdb, tuple_size, number_of_tuples, max_value, table_size,
+                                       sampledlsh_write_coitems, file, number_of_threads);
+     if (status != LSH_OK)
+          fprintf(stderr,"Error: Could not mine all the tables into file %s\n", filename);
+
+     if (fclose(file)) {
+          fprintf(stderr,"Error: Could not close file %s\n", filename);
+          return -1;
+     }
+
+     return status == LSH_OK ? 0 : -1;
+}
+
+/**
+ * @brief Mines co-occurring items from a database of vectors with LPLSH
+ *        and writes them to a file as each table is processed (see
+ *        sampledlsh_l1mine_to_file).
+ *
+ * @param filename Name of the output file
+ * @param vectordb Database of vectors
+ * @param tuple_size Number of hash values per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param width Width of the quantization bins
+ * @param table_size Initial number of buckets of the table
+ * @param ps_dist p-stable distribution
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return 0 on success, -1 on error
+ */
+int sampledlsh_lpmine_to_file(char *filename, VectorDB *vectordb, uint tuple_size, uint number_of_tuples,
+                              double width, uint table_size, double (*ps_dist)(void), uint number_of_threads)
+{
+     int status;
+     FILE *file;
+
+     if (!(file = fopen(filename,"w"))) {
+          fprintf(stderr,"Error: Could not create file %s\n", filename);
+          return -1;
+     }
+
+     status = sampledlsh_lpmine_stream(vectordb, tuple_size, number_of_tuples, width, table_size,
+                                       ps_dist, sampledlsh_write_coitems, file, number_of_threads);
+     if (status != LSH_OK)
+          fprintf(stderr,"Error: Could not mine all the tables into file %s\n", filename);
+
+     if (fclose(file)) {
+          fprintf(stderr,"Error: Could not close file %s\n", filename);
+          return -1;
+     }
+
+     return status == LSH_OK ? 0 : -1;
+}
+
+/**
+ * @brief Scoring function ranking lists of co-occurring items by size
+ *
+ * @param coitems List of co-occurring items
+ * @param data Unused
+ *
+ * @return Number of items of the list
+ */
+double sampledlsh_score_size(List *coitems, void *data)
+{
+     (void) data;
+     return (double) coitems->size;
+}
+
+/**
+ * @brief Creates a top-k structure keeping the k best lists of co-occurring
+ *        items. Lists are ranked by a scoring function or, if it is NULL,
+ *        by their multiplicity. If memory cannot be allocated the structure
+ *        has no entries and sampledlsh_topk_insert fails.
+ *
+ * @param k Number of lists to keep
+ * @param score Scoring function (e.g. sampledlsh_score_size) or NULL
+ * @param data Argument of the scoring function
+ *
+ * @return Top-k structure
+ */
+SampledTopK sampledlsh_topk_create(uint k, SampledScore score, void *data)
+{
+     SampledTopK topk;
+
+     topk.k = k;
+     topk.size = 0;
+     topk.score = score;
+     topk.data = data;
+     topk.sequence = 0;
+     topk.heap = (uint *) malloc(k * sizeof(uint));
+     topk.entries = (SampledTopKEntry *) malloc(k * sizeof(SampledTopKEntry));
+     topk.dir = bucketdir_create(k * 2);
+     if (k > 0 && (topk.heap == NULL || topk.entries == NULL || topk.dir.capacity == 0)){
+          free(topk.heap);
+          free(topk.entries);
+          bucketdir_destroy(&topk.dir);
+          topk.heap = NULL;
+          topk.entries = NULL;
+     }
+
+     return topk;
+}
+
+/**
+ * @brief Destroys a top-k structure and the lists it still keeps
+ *
+ * @param topk Top-k structure
+ */
+void sampledlsh_topk_destroy(SampledTopK *topk)
+{
+     uint i;
+
+     for (i = 0; i < topk->size; i++)
+          list_destroy(&topk->entries[i].list);
+     free(topk->heap);
+     free(topk->entries);
+     bucketdir_destroy(&topk->dir);
+     topk->heap = NULL;
+     topk->entries = NULL;
+     topk->size = 0;
+}
+
+/**
+ * @brief Checks if an entry ranks below another one. Entries with equal
+ *        scores are ranked by their first occurrence.
+ */
+static inline int sampledlsh_topk_worse(SampledTopKEntry *entry1, SampledTopKEntry *entry2)
+{
+     return entry1->score < entry2->score || (entry1->score == entry2->score && entry1->order > entry2->order);
+}
+
+/**
+ * @brief Swaps two positions of the heap of a top-k structure
+ */
+static inline void sampledlsh_topk_swap(SampledTopK *topk, uint position1, uint position2)
+{
+     uint entry = topk->heap[position1];
+
+     topk->heap[position1] = topk->heap[position2];
+     topk->heap[position2] = entry;
+     topk->entries[topk->heap[position1]].position = position1;
+     topk->entries[topk->heap[position2]].position = position2;
+}
+
+/**
+ * @brief Moves an entry up the heap while it ranks below its parent
+ */
+static void sampledlsh_topk_sift_up(SampledTopK *topk, uint position)
+{
+     while (position > 0){
+          uint parent = (position - 1) / 2;
+          if (!sampledlsh_topk_worse(&topk->entries[topk->heap[position]], &topk->entries[topk->heap[parent]]))
+               break;
+          sampledlsh_topk_swap(topk, position, parent);
+          position = parent;
+     }
+}
+
+/**
+ * @brief Moves an entry down the heap while one of its children ranks
+ *        below it
+ */
+static void sampledlsh_topk_sift_down(SampledTopK *topk, uint position)
+{
+     for (;;){
+          uint child = 2 * position + 1;
+          uint worst = position;
+          if (child < topk->size &&
+              sampledlsh_topk_worse(&topk->entries[topk->heap[child]], &topk->entries[topk->heap[worst]]))
+               worst = child;
+          if (child + 1 < topk->size &&
+              sampledlsh_topk_worse(&topk->entries[topk->heap[child + 1]], &topk->entries[topk->heap[worst]]))
+               worst = child + 1;
+          if (worst == position)
+               break;
+          sampledlsh_topk_swap(topk, position, worst);
+          position = worst;
+     }
+}
+
+/**
+ * @brief Adds an entry to the chain of entries of its hash in the
+ *        directory of a top-k structure
+ */
+static int sampledlsh_topk_link(SampledTopK *topk, uint entry)
+{
+     topk->entries[entry].next = bucketdir_find(&topk->dir, topk->entries[entry].hash);
+
+     return bucketdir_assign(&topk->dir, topk->entries[entry].hash, entry);
+}
+
+/**
+ * @brief Removes an entry from the chain of entries of its hash in the
+ *        directory of a top-k structure. The hash stays in the directory
+ *        (with LSH_NO_INDEX if the chain is left empty).
+ */
+static int sampledlsh_topk_unlink(SampledTopK *topk, uint entry)
+{
+     ullong hash = topk->entries[entry].hash;
+     uint previous = bucketdir_find(&topk->dir, hash);
+
+     if (previous == entry)
+          return bucketdir_assign(&topk->dir, hash, topk->entries[entry].next);
+
+     while (topk->entries[previous].next != entry)
+          previous = topk->entries[previous].next;
+     topk->entries[previous].next = topk->entries[entry].next;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Rebuilds the directory of a top-k structure from its kept
+ *        entries once the hashes of evicted lists outnumber them
+ */
+static int sampledlsh_topk_rebuild(SampledTopK *topk)
+{
+     uint i;
+
+     if (topk->dir.size < 4 * topk->k)
+          return LSH_OK;
+
+     bucketdir_clear(&topk->dir);
+     for (i = 0; i < topk->size; i++)
+          if (sampledlsh_topk_link(topk, i) != LSH_OK)
+               return LSH_NO_MEMORY;
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Finds the kept entry of a list of co-occurring items. Entries
+ *        whose lists have the same hash are chained, and their items are
+ *        compared.
+ *
+ * @return Entry of the list, LSH_NO_INDEX if it is not kept
+ */
+static uint sampledlsh_topk_find(SampledTopK *topk, List *coitems, ullong hash)
+{
+     uint entry = bucketdir_find(&topk->dir, hash);
+
+     while (entry != LSH_NO_INDEX && !sampledlsh_equal_sets(&topk->entries[entry].list, coitems))
+          entry = topk->entries[entry].next;
+
+     return entry;
+}
+
+/**
+ * @brief Sink inserting a list of co-occurring items in a top-k structure
+ *        (a min-heap whose root is the worst kept list). A list that is
+ *        already kept, with the same hash and items, only increases its
+ *        multiplicity. Otherwise, it is
+ *        copied if there is room or if it ranks above the root, which is
+ *        then evicted. With a scoring function, lists are never re-scored,
+ *        so kept lists have their exact multiplicity. When ranking by
+ *        multiplicity, a new list replaces the root and inherits its
+ *        multiplicity plus one (Space-Saving), so multiplicities are upper
+ *        bounds, exact if fewer than k distinct lists were found.
+ *
+ * @param coitems List of co-occurring items
+ * @param arg Top-k structure (SampledTopK *)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int sampledlsh_topk_insert(List *coitems, void *arg)
+{
+     uint entry;
+     ullong hash;
+     double score = 0.0;
+     uint multiplicity = 1;
+     SampledTopK *topk = (SampledTopK *) arg;
+     SampledTopKEntry *root = NULL;
+
+     if (topk->k == 0)
+          return LSH_OK;
+     if (topk->entries == NULL)
+          return LSH_NO_MEMORY;
+
+     topk->sequence++;
+     if (topk->size == topk->k)
+          root = &topk->entries[topk->heap[0]];
+
+     if (topk->score != NULL){
+          score = topk->score(coitems, topk->data);
+          if (root != NULL && score < root->score) // ranks below all kept lists
+               return LSH_OK;
+     }
+
+     hash = sampledlsh_hash_set(coitems);
+     entry = sampledlsh_topk_find(topk, coitems, hash);
+     if (entry != LSH_NO_INDEX){
+          topk->entries[entry].multiplicity++;
+          if (topk->score == NULL){
+               topk->entries[entry].score = (double) topk->entries[entry].multiplicity;
+               sampledlsh_topk_sift_down(topk, topk->entries[entry].position);
+          }
+          return LSH_OK;
+     }
+
+     if (topk->size < topk->k){
+          entry = topk->size;
+          if (topk->score == NULL)
+               score = 1.0;
+     } else {
+          entry = topk->heap[0];
+          if (topk->score == NULL){
+               multiplicity = root->multiplicity + 1;
+               score = (double) multiplicity;
+          } else if (score <= root->score){ // equal scores keep the first list
+               return LSH_OK;
+          }
+     }
+
+     if (sampledlsh_topk_rebuild(topk) != LSH_OK)
+          return LSH_NO_MEMORY;
+
+     if (entry < topk->size){ // evicts the root
+          if (sampledlsh_topk_unlink(topk, entry) != LSH_OK)
+               return LSH_NO_MEMORY;
+          list_destroy(&topk->entries[entry].list);
+     }
+     topk->entries[entry].list = list_duplicate(coitems);
+     topk->entries[entry].hash = hash;
+     if (sampledlsh_topk_link(topk, entry) != LSH_OK)
+          return LSH_NO_MEMORY;
+     topk->entries[entry].order = topk->sequence;
+     topk->entries[entry].score = score;
+     topk->entries[entry].multiplicity = multiplicity;
+
+     if (entry == topk->size){
+          topk->heap[entry] = entry;
+          topk->entries[entry].position = entry;
+          topk->size++;
+          sampledlsh_topk_sift_up(topk, entry);
+     } else {
+          sampledlsh_topk_sift_down(topk, 0);
+     }
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Compares two entries of a top-k structure (best first)
+ */
+static int sampledlsh_topk_compare(const void *a, const void *b)
+{
+     SampledTopKEntry *entry1 = (SampledTopKEntry *) a;
+     SampledTopKEntry *entry2 = (SampledTopKEntry *) b;
+
+     if (sampledlsh_topk_worse(entry2, entry1))
+          return -1;
+     else if (sampledlsh_topk_worse(entry1, entry2))
+          return 1;
+     return 0;
+}
+
+/**
+ * @brief Moves the lists of a top-k structure to a database from best to
+ *        worst and empties the structure
+ *
+ * @param topk Top-k structure
+ * @param coitems Database of co-occurring items
+ * @param multiplicity Number of tables that found each list (item: position
+ *        of the list in the database, freq: multiplicity)
+ *
+ * @return LSH_OK or LSH_NO_MEMORY
+ */
+int sampledlsh_topk_collect(SampledTopK *topk, ListDB *coitems, List *multiplicity)
+{
+     uint i;
+     uint size = topk->size;
+
+     coitems->lists = (List *) malloc(size * sizeof(List));
+     multiplicity->data = (Item *) malloc(size * sizeof(Item));
+     if (size > 0 && (coitems->lists == NULL || multiplicity->data == NULL)){
+          free(coitems->lists);
+          free(multiplicity->data);
+          coitems->lists = NULL;
+          list_init(multiplicity);
+          return LSH_NO_MEMORY;
+     }
+
+     qsort(topk->entries, size, sizeof(SampledTopKEntry), sampledlsh_topk_compare);
+
+     for (i = 0; i < size; i++){
+          coitems->lists[i] = topk->entries[i].list;
+          multiplicity->data[i].item = i;
+          multiplicity->data[i].freq = topk->entries[i].multiplicity;
+     }
+     coitems->size = size;
+     multiplicity->size = size;
+
+     topk->size = 0; // lists are now owned by coitems
+     bucketdir_clear(&topk->dir);
+
+     return LSH_OK;
+}
+
+/**
+ * @brief Mines the k best lists of co-occurring items from a database of
+ *        lists with L1LSH. Tables are mined one at a time as in
+ *        sampledlsh_l1mine_stream and each list is given to a top-k
+ *        structure (see sampledlsh_topk_insert), so memory does not grow
+ *        with the number of mined lists.
+ *
+ * @param listdb Database of lists (item frequencies of each dimension)
+ * @param tuple_size Number of sampled bits per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param max_value Largest value of an item frequency
+ * @param table_size Initial number of buckets of the table
+ * @param k Number of lists to keep
+ * @param score Scoring function (e.g. sampledlsh_score_size) or NULL to
+ *        rank lists by multiplicity
+ * @param data Argument of the scoring function
+ * @param multiplicity Number of tables that found each list (item:
+ *        position of the list, freq: multiplicity)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of the best co-occurring items, from best to worst
+ */
+ListDB sampledlsh_l1mine_topk(ListDB *listdb, uint tuple_size, uint number_of_tuples, uint max_value,
+                              uint table_size, uint k, SampledScore score, void *data, List *multiplicity,
+                              uint number_of_threads)
+{
+     ListDB coitems;
+     SampledTopK topk = sampledlsh_topk_create(k, score, data);
+
+     listdb_init(&coitems);
+     list_init(multiplicity);
+
+     if (sampledlsh_l1mine_stream(listdb, tuple_size, number_of_tuples, max_value, table_size,
+                                  sampledlsh_topk_insert, &topk, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+     if (sampledlsh_topk_collect(&topk, &coitems, multiplicity) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to collect the mined lists\n");
+     coitems.dim = listdb->size;
+     sampledlsh_topk_destroy(&topk);
+
+     return coitems;
+}
+
+/**
+ * @brief Mines the k best lists of co-occurring items from a database of
+ *        vectors with LPLSH (see sampledlsh_l1mine_topk).
+ *
+ * @param vectordb Database of vectors
+ * @param tuple_size Number of hash values per tuple
+ * @param number_of_tuples Number of tuples (tables)
+ * @param width Width of the quantization bins
+ * @param table_size Initial number of buckets of the table
+ * @param ps_dist p-stable distribution
+ * @param k Number of lists to keep
+ * @param score Scoring function or NULL to rank lists by multiplicity
+ * @param data Argument of the scoring function
+ * @param multiplicity Number of tables that found each list (item:
+ *        position of the list, freq: multiplicity)
+ * @param number_of_threads Number of threads (0 for all processors)
+ *
+ * @return Database of the best co-occurring items, from best to worst
+ */
+ListDB sampledlsh_lpmine_topk(VectorDB *vectordb, uint tuple_size, uint number_of_tuples, double width,
+                              uint table_size, double (*ps_dist)(void), uint k, SampledScore score,
+                              void *data, List *multiplicity, uint number_of_threads)
+{
+     ListDB coitems;
+     SampledTopK topk = sampledlsh_topk_create(k, score, data);
+
+     listdb_init(&coitems);
+     list_init(multiplicity);
+
+     if (sampledlsh_lpmine_stream(vectordb, tuple_size, number_of_tuples, width, table_size, ps_dist,
+                                  sampledlsh_topk_insert, &topk, number_of_threads) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to mine all the tables\n");
+     if (sampledlsh_topk_collect(&topk, &coitems, multiplicity) != LSH_OK)
+          fprintf(stderr,"Error: Not enough memory to collect the mined lists\n");
+     coitems.dim = vectordb->size;
+     sampledlsh_topk_destroy(&topk);
+
+     return coitems;
+}
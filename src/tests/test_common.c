@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include "mt64.h"
+#include "test_common.h"
+
+static uint failures = 0;
+
+/**
+ * @brief Reports a failed check
+ */
+void check(int condition, const char *name)
+{
+     if (!condition){
+          fprintf(stderr,"FAILED: %s\n", name);
+          failures++;
+     }
+}
+
+/**
+ * @brief Prints the result of the checks
+ *
+ * @return Exit status of the test (0 if all checks passed)
+ */
+int report_checks(void)
+{
+     if (failures > 0){
+          fprintf(stderr,"%u checks failed\n", failures);
+          return 1;
+     }
+     printf("All checks passed\n");
+
+     return 0;
+}
+
+/**
+ * @brief Creates a database of lists in clusters of similar lists, with
+ *        some empty lists
+ */
+ListDB make_listdb(void)
+{
+     uint i, k;
+     ListDB listdb = listdb_create(TEST_SIZE, TEST_DIM);
+
+     for (i = 0; i < TEST_SIZE; i++){
+          uint cluster = (uint) (genrand64_int64() % 60);
+          if (i % 97 == 13)
+               continue;
+          for (k = 0; k < 12; k++){
+               Item item = {(cluster * 7 + k) % TEST_DIM, 1 + (uint) (genrand64_int64() % (TEST_MAX_VALUE - 1))};
+               if (genrand64_int64() % 6 == 0)
+                    item.item = (uint) (genrand64_int64() % TEST_DIM);
+               list_push(&listdb.lists[i], item);
+          }
+          list_sort_by_item(&listdb.lists[i]);
+          list_unique(&listdb.lists[i]);
+     }
+
+     return listdb;
+}
+
+/**
+ * @brief Creates a database of vectors from a database of lists
+ */
+VectorDB make_vectordb(ListDB *listdb)
+{
+     uint i, k;
+     VectorDB vectordb = vectordb_create(listdb->size, listdb->dim);
+
+     for (i = 0; i < listdb->size; i++)
+          for (k = 0; k < listdb->lists[i].size; k++){
+               Dim dim = {listdb->lists[i].data[k].item, (double) listdb->lists[i].data[k].freq};
+               vector_push(&vectordb.vectors[i], dim);
+          }
+
+     return vectordb;
+}
+
+/**
+ * @brief Creates a database of dense lists (one item per dimension), as
+ *        L1LSH expects, from a database of lists. Empty lists stay empty.
+ */
+ListDB make_dense_listdb(ListDB *listdb)
+{
+     uint i, k;
+     ListDB dense = listdb_create(listdb->size, listdb->dim);
+
+     for (i = 0; i < listdb->size; i++){
+          if (listdb->lists[i].size == 0)
+               continue;
+          for (k = 0; k < listdb->dim; k++){
+               Item item = {k, 0};
+               list_push(&dense.lists[i], item);
+          }
+          for (k = 0; k < listdb->lists[i].size; k++)
+               dense.lists[i].data[listdb->lists[i].data[k].item].freq = listdb->lists[i].data[k].freq;
+     }
+
+     return dense;
+}
+
+/**
+ * @brief Checks if two lists of candidates have the same IDs
+ */
+int same_candidates(List *candidates1, List *candidates2)
+{
+     uint i;
+
+     if (candidates1->size != candidates2->size)
+          return 0;
+     for (i = 0; i < candidates1->size; i++)
+          if (candidates1->data[i].item != candidates2->data[i].item)
+               return 0;
+
+     return 1;
+}
@@ -0,0 +1,21 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include "types.h"
+#include "array_lists.h"
+#include "listdb.h"
+#include "vectordb.h"
+
+#define TEST_SIZE 3000
+#define TEST_DIM 400
+#define TEST_MAX_VALUE 8
+#define TEST_SEED 0x12345ULL
+
+/************************ Function prototypes ************************/
+void check(int, const char *);
+int report_checks(void);
+ListDB make_listdb(void);
+VectorDB make_vectordb(ListDB *);
+ListDB make_dense_listdb(ListDB *);
+int same_candidates(List *, List *);
+#endif
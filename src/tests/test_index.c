@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "minhash.h"
+#include "l1lsh.h"
+#include "lplsh.h"
+#include "test_common.h"
+
+/**
+ * @brief Fingerprint of a hash table: the hash value and IDs of each used
+ *        bucket, in the order of the list of used buckets
+ */
+#define TABLE_FINGERPRINT(hash_table, fingerprint)                                 \
+     do {                                                                       \
+          uint t_, u_;                                                          \
+          fingerprint = (hash_table)->used_buckets.size;                        \
+          for (t_ = 0; t_ < (hash_table)->used_buckets.size; t_++){             \
+               uint b_ = (hash_table)->used_buckets.data[t_].item;              \
+               List *items_ = &(hash_table)->buckets[b_].items;                 \
+               fingerprint = (fingerprint ^ (hash_table)->buckets[b_].hash_value) * 0x100000001b3ULL; \
+               fingerprint = (fingerprint ^ items_->size) * 0x100000001b3ULL;   \
+               for (u_ = 0; u_ < items_->size; u_++)                            \
+                    fingerprint = (fingerprint ^ items_->data[u_].item) * 0x100000001b3ULL; \
+          }                                                                     \
+     } while (0)
+
+/**
+ * @brief Checks that storing a database from several threads gives the
+ *        same buckets, in the same order, and the same indices as the bulk
+ *        build
+ */
+static void test_parallel_store(ListDB *listdb, VectorDB *vectordb)
+{
+     uint i, t;
+     ListDB dense = make_dense_listdb(listdb);
+     uint threads[] = {2, 3, 8};
+     uint *indices = (uint *) malloc(TEST_SIZE * sizeof(uint));
+     uint *bulk_indices = (uint *) malloc(TEST_SIZE * sizeof(uint));
+     ullong bulk, parallel;
+
+     mh_rng_init(TEST_SEED);
+     HashTableMH mh = mh_create(1024, 2, TEST_DIM);
+     mh_generate_functions(&mh);
+     check(mh_store_listdb_bulk(listdb, &mh, bulk_indices) == LSH_OK, "minhash bulk store");
+     TABLE_FINGERPRINT(&mh, bulk);
+     mh_clear_table(&mh);
+     for (t = 0; t < 3; t++){
+          check(mh_store_listdb_parallel(listdb, &mh, indices, threads[t]) == LSH_OK, "minhash parallel store");
+          TABLE_FINGERPRINT(&mh, parallel);
+          check(bulk == parallel, "minhash parallel buckets");
+          for (i = 0; i < TEST_SIZE; i++)
+               if (indices[i] != bulk_indices[i])
+                    break;
+          check(i == TEST_SIZE, "minhash parallel indices");
+          mh_clear_table(&mh);
+     }
+     mh_destroy(&mh);
+
+     HashTableL1 l1 = l1lsh_create(1024, 8, TEST_DIM, TEST_MAX_VALUE);
+     l1lsh_generate_functions(&l1);
+     check(l1lsh_store_listdb_bulk(&dense, &l1, bulk_indices) == LSH_OK, "l1lsh bulk store");
+     TABLE_FINGERPRINT(&l1, bulk);
+     l1lsh_clear_table(&l1);
+     for (t = 0; t < 3; t++){
+          check(l1lsh_store_listdb_parallel(&dense, &l1, indices, threads[t]) == LSH_OK, "l1lsh parallel store");
+          TABLE_FINGERPRINT(&l1, parallel);
+          check(bulk == parallel, "l1lsh parallel buckets");
+          for (i = 0; i < TEST_SIZE; i++)
+               if (indices[i] != bulk_indices[i])
+                    break;
+          check(i == TEST_SIZE, "l1lsh parallel indices");
+          l1lsh_clear_table(&l1);
+     }
+     l1lsh_destroy(&l1);
+
+     HashTableLP lp = lplsh_create(1024, 3, TEST_DIM, 4.0);
+     lplsh_generate_functions(&lp, lplsh_rng_gaussian);
+     check(lplsh_store_vectordb_bulk(vectordb, &lp, bulk_indices) == LSH_OK, "lplsh bulk store");
+     TABLE_FINGERPRINT(&lp, bulk);
+     lplsh_clear_table(&lp);
+     for (t = 0; t < 3; t++){
+          check(lplsh_store_vectordb_parallel(vectordb, &lp, indices, threads[t]) == LSH_OK, "lplsh parallel store");
+          TABLE_FINGERPRINT(&lp, parallel);
+          check(bulk == parallel, "lplsh parallel buckets");
+          for (i = 0; i < TEST_SIZE; i++)
+               if (indices[i] != bulk_indices[i])
+                    break;
+          check(i == TEST_SIZE, "lplsh parallel indices");
+          lplsh_clear_table(&lp);
+     }
+     lplsh_destroy(&lp);
+
+     listdb_destroy(&dense);
+     free(indices);
+     free(bulk_indices);
+}
+
+/**
+ * @brief Inverts a list database by pushing each list in the inverted lists
+ *        of its items, one by one
+ */
+static ListDB naive_invert(ListDB *listdb)
+{
+     uint i, j, number_of_items = listdb->dim;
+     ListDB inverted;
+
+     for (i = 0; i < listdb->size; i++)
+          for (j = 0; j < listdb->lists[i].size; j++)
+               if (number_of_items < listdb->lists[i].data[j].item + 1)
+                    number_of_items = listdb->lists[i].data[j].item + 1;
+
+     inverted = listdb_create(number_of_items, listdb->size);
+     for (i = 0; i < listdb->size; i++)
+          for (j = 0; j < listdb->lists[i].size; j++){
+               Item posting = {i, listdb->lists[i].data[j].freq};
+               list_push(&inverted.lists[listdb->lists[i].data[j].item], posting);
+          }
+
+     return inverted;
+}
+
+/**
+ * @brief Checks that two list databases have the same lists, with the same
+ *        items and frequencies
+ */
+static int same_listdb(ListDB *listdb1, ListDB *listdb2)
+{
+     uint i;
+
+     if (listdb1->size != listdb2->size || listdb1->dim != listdb2->dim)
+          return 0;
+     for (i = 0; i < listdb1->size; i++){
+          if (listdb1->lists[i].size != listdb2->lists[i].size)
+               return 0;
+          if (listdb1->lists[i].size > 0 &&
+              memcmp(listdb1->lists[i].data, listdb2->lists[i].data, listdb1->lists[i].size * sizeof(Item)) != 0)
+               return 0;
+     }
+
+     return 1;
+}
+
+/**
+ * @brief Checks that inverting a list database with several threads gives
+ *        the same inverted file as pushing each list in its items. Besides
+ *        the test database, it inverts the same lists with a dimension
+ *        smaller than their largest item and fewer lists than threads.
+ */
+static void test_listdb_invert(ListDB *listdb)
+{
+     uint d, t;
+     uint threads[] = {1, 2, 8};
+     ListDB databases[3] = {*listdb, *listdb, *listdb}; // share the lists
+     databases[1].dim = 10;
+     databases[2].size = 3;
+
+     for (d = 0; d < 3; d++){
+          ListDB naive = naive_invert(&databases[d]);
+          for (t = 0; t < 3; t++){
+               ListDB inverted = listdb_invert(&databases[d], threads[t]);
+               check(same_listdb(&inverted, &naive), "listdb inversion");
+               listdb_destroy(&inverted);
+          }
+          listdb_destroy(&naive);
+     }
+}
+
+int main(void)
+{
+     mh_rng_init(TEST_SEED);
+     ListDB listdb = make_listdb();
+     VectorDB vectordb = make_vectordb(&listdb);
+
+     test_parallel_store(&listdb, &vectordb);
+     test_listdb_invert(&listdb);
+
+     vectordb_destroy(&vectordb);
+     listdb_destroy(&listdb);
+
+     return report_checks();
+}
@@ -7,7 +7,7 @@ void test_l1lsh(char *input)
 {
      ListDB data = listdb_load_from_file(input);
      
-     ListDB coitems = sampledlsh_l1mine(&data, 50, 10, 255, 1024);
+     ListDB coitems = sampledlsh_l1mine(&data, 50, 10, 255, 1024, 0);
      listdb_print(&coitems);
 }
 
@@ -15,7 +15,7 @@ void test_lplsh_cauchy(char *input)
 {
      VectorDB data = vectordb_load_from_file(input);
      
-     ListDB coitems = sampledlsh_lpmine(&data, 10, 10, 4.0, 1024, lplsh_rng_cauchy);
+     ListDB coitems = sampledlsh_lpmine(&data, 10, 10, 4.0, 1024, lplsh_rng_cauchy, 0);
      listdb_print(&coitems);
 }
 
@@ -23,7 +23,7 @@ void test_lplsh_gaussian(char *input)
 {
      VectorDB data = vectordb_load_from_file(input);
      
-     ListDB coitems = sampledlsh_lpmine(&data, 25, 10, 2.0, 1024, lplsh_rng_gaussian);
+     ListDB coitems = sampledlsh_lpmine(&data, 25, 10, 2.0, 1024, lplsh_rng_gaussian, 0);
      listdb_print(&coitems);
 }
 
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "minhash.h"
+#include "mhsorted.h"
+#include "test_common.h"
+
+/**
+ * @brief Checks that a sorted index returns the same candidates as a hash
+ *        index with the same MinHash functions, also after saving and
+ *        loading it
+ */
+static void test_sorted_query(ListDB *listdb)
+{
+     uint i;
+     uint mismatches = 0, reloaded_mismatches = 0, nonempty = 0;
+     char filename[] = "test_sorted.bin";
+
+     mh_rng_init(TEST_SEED);
+     HashIndexMH index = mh_index_create(8, 1024, 2, TEST_DIM, MH_HASHED, NULL);
+     mh_rng_init(TEST_SEED);
+     SortedIndexMH sorted = mhsorted_create(8, 2, TEST_DIM, MH_HASHED, NULL);
+     check(mh_index_build(&index, listdb) == LSH_OK, "hash index build");
+     check(mhsorted_build(&sorted, listdb) == LSH_OK, "sorted index build");
+     check(mhsorted_save(filename, &sorted) == 0, "sorted index save");
+     SortedIndexMH loaded = mhsorted_load(filename, NULL);
+     check(loaded.size == sorted.size, "sorted index load");
+
+     for (i = 0; i < listdb->size; i++){
+          List candidates = mh_index_query(&index, &listdb->lists[i]);
+          List sorted_candidates = mhsorted_query(&sorted, &listdb->lists[i]);
+          List loaded_candidates = mhsorted_query(&loaded, &listdb->lists[i]);
+          mismatches += !same_candidates(&candidates, &sorted_candidates);
+          reloaded_mismatches += !same_candidates(&sorted_candidates, &loaded_candidates);
+          nonempty += candidates.size > 1;
+          list_destroy(&candidates);
+          list_destroy(&sorted_candidates);
+          list_destroy(&loaded_candidates);
+     }
+     check(nonempty > 0, "queries find similar lists");
+     check(mismatches == 0, "sorted index candidates");
+     check(reloaded_mismatches == 0, "loaded sorted index candidates");
+
+     mhsorted_destroy(&loaded);
+     remove(filename);
+     mhsorted_destroy(&sorted);
+     mh_index_destroy(&index);
+}
+
+/**
+ * @brief Checks that a sorted index built with weights is only loaded if
+ *        the weights are given, and then returns the same candidates
+ */
+static void test_sorted_weights(ListDB *listdb)
+{
+     uint i;
+     uint mismatches = 0;
+     char filename[] = "test_sorted_weighted.bin";
+     double *weights = (double *) malloc(TEST_DIM * sizeof(double));
+
+     for (i = 0; i < TEST_DIM; i++)
+          weights[i] = 1.0 + (i % 4);
+
+     mh_rng_init(TEST_SEED);
+     SortedIndexMH sorted = mhsorted_create(8, 2, TEST_DIM, MH_HASHED, weights);
+     check(mhsorted_build(&sorted, listdb) == LSH_OK, "weighted sorted index build");
+     check(mhsorted_save(filename, &sorted) == 0, "weighted sorted index save");
+
+     SortedIndexMH unweighted = mhsorted_load(filename, NULL);
+     check(unweighted.number_of_tables == 0, "weighted sorted index refused without weights");
+     mhsorted_destroy(&unweighted);
+
+     SortedIndexMH loaded = mhsorted_load(filename, weights);
+     check(loaded.size == sorted.size, "weighted sorted index load");
+     for (i = 0; i < listdb->size; i++){
+          List sorted_candidates = mhsorted_query(&sorted, &listdb->lists[i]);
+          List loaded_candidates = mhsorted_query(&loaded, &listdb->lists[i]);
+          mismatches += !same_candidates(&sorted_candidates, &loaded_candidates);
+          list_destroy(&sorted_candidates);
+          list_destroy(&loaded_candidates);
+     }
+     check(mismatches == 0, "loaded weighted sorted index candidates");
+
+     mhsorted_destroy(&loaded);
+     remove(filename);
+     mhsorted_destroy(&sorted);
+     free(weights);
+}
+
+int main(void)
+{
+     mh_rng_init(TEST_SEED);
+     ListDB listdb = make_listdb();
+
+     test_sorted_query(&listdb);
+     test_sorted_weights(&listdb);
+
+     listdb_destroy(&listdb);
+
+     return report_checks();
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "minhash.h"
+#include "l1lsh.h"
+#include "lplsh.h"
+#include "test_common.h"
+
+/**
+ * @brief Removes the deleted IDs from a list of candidates
+ */
+static void drop_deleted(List *candidates, uint *deleted)
+{
+     uint i, size = 0;
+
+     for (i = 0; i < candidates->size; i++)
+          if (!deleted[candidates->data[i].item])
+               candidates->data[size++] = candidates->data[i];
+     candidates->size = size;
+}
+
+/**
+ * @brief Deletes and updates lists of a database: every third list is
+ *        deleted (emptied) and every fifth one takes the items of another
+ *        list. Deletions are enough for the indexes to compact.
+ */
+static void modify_listdb(ListDB *listdb, uint *deleted, uint *updated)
+{
+     uint i;
+
+     for (i = 0; i < listdb->size; i++){
+          deleted[i] = (i % 3 == 1);
+          updated[i] = !deleted[i] && (i % 5 == 2);
+          if (deleted[i]){
+               list_destroy(&listdb->lists[i]);
+          } else if (updated[i]){
+               List *source = &listdb->lists[(i * 7 + 11) % listdb->size];
+               list_destroy(&listdb->lists[i]);
+               listdb->lists[i] = source->size ? list_duplicate(source) : listdb->lists[i];
+          }
+     }
+}
+
+/**
+ * @brief Checks that deleting and updating lists of an index gives the
+ *        same candidates as an index built from the modified database
+ */
+static void test_index_updates(ListDB *original)
+{
+     uint i;
+     uint mh_mismatches = 0, l1_mismatches = 0, lp_mismatches = 0;
+     uint *deleted = (uint *) malloc(original->size * sizeof(uint));
+     uint *updated = (uint *) malloc(original->size * sizeof(uint));
+     ListDB modified = listdb_create(original->size, original->dim);
+
+     for (i = 0; i < original->size; i++)
+          if (original->lists[i].size > 0)
+               modified.lists[i] = list_duplicate(&original->lists[i]);
+     modify_listdb(&modified, deleted, updated);
+     VectorDB original_vectors = make_vectordb(original);
+     VectorDB modified_vectors = make_vectordb(&modified);
+     ListDB original_dense = make_dense_listdb(original);
+     ListDB modified_dense = make_dense_listdb(&modified);
+
+     mh_rng_init(TEST_SEED);
+     HashIndexMH mh = mh_index_create(6, 1024, 2, TEST_DIM, MH_HASHED, NULL);
+     mh_rng_init(TEST_SEED);
+     HashIndexMH mh_ref = mh_index_create(6, 1024, 2, TEST_DIM, MH_HASHED, NULL);
+     mh_index_build(&mh, original);
+     mh_index_build(&mh_ref, &modified);
+
+     l1lsh_rng_init(TEST_SEED);
+     HashIndexL1 l1 = l1lsh_index_create(6, 1024, 8, TEST_DIM, TEST_MAX_VALUE);
+     l1lsh_rng_init(TEST_SEED);
+     HashIndexL1 l1_ref = l1lsh_index_create(6, 1024, 8, TEST_DIM, TEST_MAX_VALUE);
+     l1lsh_index_build(&l1, &original_dense);
+     l1lsh_index_build(&l1_ref, &modified_dense);
+
+     l1lsh_rng_init(TEST_SEED);
+     HashIndexLP lp = lplsh_index_create(6, 1024, 3, TEST_DIM, 4.0, lplsh_rng_gaussian);
+     l1lsh_rng_init(TEST_SEED);
+     HashIndexLP lp_ref = lplsh_index_create(6, 1024, 3, TEST_DIM, 4.0, lplsh_rng_gaussian);
+     lplsh_index_build(&lp, &original_vectors);
+     lplsh_index_build(&lp_ref, &modified_vectors);
+
+     for (i = 0; i < original->size; i++){
+          if (deleted[i]){ // empty lists are not stored, empty vectors are the origin
+               int status = original->lists[i].size > 0 ? LSH_OK : LSH_INVALID;
+               check(mh_index_delete(&mh, i) == status, "minhash index delete");
+               check(l1lsh_index_delete(&l1, i) == status, "l1lsh index delete");
+               check(lplsh_index_delete(&lp, i) == LSH_OK, "lplsh index delete");
+          } else if (updated[i]){
+               check(mh_index_update(&mh, i, &modified.lists[i]) == LSH_OK, "minhash index update");
+               check(l1lsh_index_update(&l1, i, &modified_dense.lists[i]) == LSH_OK, "l1lsh index update");
+               check(lplsh_index_update(&lp, i, &modified_vectors.vectors[i]) == LSH_OK, "lplsh index update");
+          }
+     }
+
+     // queries with the old and new lists must not find deleted or moved IDs
+     for (i = 0; i < original->size; i++){
+          List *queries[2] = {&original->lists[i], &modified.lists[i]};
+          List *dense_queries[2] = {&original_dense.lists[i], &modified_dense.lists[i]};
+          Vector *vector_queries[2] = {&original_vectors.vectors[i], &modified_vectors.vectors[i]};
+          uint q;
+          for (q = 0; q < 2; q++){
+               List candidates = mh_index_query(&mh, queries[q]);
+               List reference = mh_index_query(&mh_ref, queries[q]);
+               mh_mismatches += !same_candidates(&candidates, &reference);
+               list_destroy(&candidates);
+               list_destroy(&reference);
+
+               if (dense_queries[q]->size > 0){
+                    candidates = l1lsh_index_query(&l1, dense_queries[q]);
+                    reference = l1lsh_index_query(&l1_ref, dense_queries[q]);
+                    l1_mismatches += !same_candidates(&candidates, &reference);
+                    list_destroy(&candidates);
+                    list_destroy(&reference);
+               }
+
+               candidates = lplsh_index_query(&lp, vector_queries[q]);
+               reference = lplsh_index_query(&lp_ref, vector_queries[q]);
+               drop_deleted(&reference, deleted); // the reference stores them at the origin
+               lp_mismatches += !same_candidates(&candidates, &reference);
+               list_destroy(&candidates);
+               list_destroy(&reference);
+          }
+     }
+     check(mh_mismatches == 0, "minhash index after deletes and updates");
+     check(l1_mismatches == 0, "l1lsh index after deletes and updates");
+     check(lp_mismatches == 0, "lplsh index after deletes and updates");
+
+     mh_index_destroy(&mh);
+     mh_index_destroy(&mh_ref);
+     l1lsh_index_destroy(&l1);
+     l1lsh_index_destroy(&l1_ref);
+     lplsh_index_destroy(&lp);
+     lplsh_index_destroy(&lp_ref);
+     vectordb_destroy(&original_vectors);
+     vectordb_destroy(&modified_vectors);
+     listdb_destroy(&original_dense);
+     listdb_destroy(&modified_dense);
+     listdb_destroy(&modified);
+     free(deleted);
+     free(updated);
+}
+
+int main(void)
+{
+     mh_rng_init(TEST_SEED);
+     ListDB listdb = make_listdb();
+
+     test_index_updates(&listdb);
+
+     listdb_destroy(&listdb);
+
+     return report_checks();
+}